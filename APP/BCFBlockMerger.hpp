@@ -1,6 +1,8 @@
 #pragma once  
 #include "Reader/BCFStreamReader.hpp"  
+#include "Reader/BCFSubChunkPrefetcher.hpp"
 #include "Writer/BCFCachedWriter.hpp"  
+#include "core/Log.hpp"
 #include <vector>  
 #include <string>  
 #include <iostream>
@@ -12,7 +14,7 @@ private:
 public:
     BCFBlockMerger(const std::string& input) {
         inputFilename = input;
-        // Զ_merged׺  
+        // 自动添加_merged后缀  
         size_t dotPos = input.find_last_of('.');
         if (dotPos != std::string::npos) {
             outputFilename = input.substr(0, dotPos) + "_merged" + input.substr(dotPos);
@@ -27,44 +29,31 @@ public:
         BCFStreamReader reader(inputFilename);
         BCFCachedWriter writer(outputFilename);
 
-        size_t totalSubChunks = reader.getSubChunkCount();
-
-        for (size_t i = 0; i < totalSubChunks; i++) {
-            auto regions = reader.getBlockRegions(i);
-            auto origin = reader.getSubChunkOrigin(i);
+        // palette 按 ID 重映射: 每个源 palette 条目只在写入器中注册一次 (保留 NBT)
+        std::vector<PaletteID> paletteRemap(reader.getPaletteCount());
+        for (size_t pid = 0; pid < paletteRemap.size(); pid++) {
+            const DecodedPaletteEntry& decoded = reader.getDecodedPalette(static_cast<PaletteID>(pid));
+            paletteRemap[pid] = writer.registerPalette(decoded.typeName, decoded.states,
+                reader.getBlockNBTData(static_cast<PaletteID>(pid)));
+        }
 
-            // չΪ  
-            for (const auto& region : regions) {
-                const PaletteKey& paletteKey = reader.getPaletteKey(region.paletteId);
-                std::string blockType = reader.getBlockType(paletteKey.typeId);
+        // 后台预取子区块, 读取与写入并行
+        BCFSubChunkPrefetcher prefetcher(reader);
+        PrefetchedSubChunk subChunk;
 
-                // ״̬  
-                std::vector<std::pair<std::string, std::string>> states;
-                for (const auto& state : paletteKey.states) {
-                    std::string stateName = reader.getStateName(state.first);
-                    std::string stateValue = reader.getStateValue(state.second);
-                    states.emplace_back(stateName, stateValue);
-                }
+        while (prefetcher.next(subChunk)) {
+            const auto& origin = subChunk.origin;
 
-                // չΪ鲢  
-                for (Coord x = region.x1; x <= region.x2; x++) {
-                    for (Coord y = region.y1; y <= region.y2; y++) {
-                        for (Coord z = region.z1; z <= region.z2; z++) {
-                            // ʹԭʼ꣨originƫƣ  
-                            writer.addBlock(
-                                origin.originX + x,
-                                origin.originY + y,
-                                origin.originZ + z,
-                                blockType,
-                                states
-                            );
-                        }
-                    }
-                }
+            // 区域直接以长方体写入, 不再展开为单个方块; 相邻同 palette 区域在 finalize 时合并
+            for (const auto& region : subChunk.regions) {
+                writer.addRegion(
+                    origin.originX + region.x1, origin.originY + region.y1, origin.originZ + region.z1,
+                    origin.originX + region.x2, origin.originY + region.y2, origin.originZ + region.z2,
+                    paletteRemap[region.paletteId]);
             }
         }
 
         writer.finalize();
-        std::cout << "ϲ! ļ: " << outputFilename << std::endl;
+        Log::info() << "合并完成! 输出文件: " << outputFilename;
     }
 };
\ No newline at end of file
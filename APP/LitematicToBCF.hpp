@@ -1,9 +1,18 @@
 #pragma once
 #include "Writer/BCFCachedWriter.hpp"
 #include "core/BlockStateConverter.hpp"
+#include "core/PackedBitArray.hpp"
+#include "core/BlockEntityIndex.hpp"
+#include "core/Log.hpp"
 #include <nbt_tags.h>
 #include <io/stream_reader.h>
 #include <io/izlibstream.h>
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+#include <unordered_map>
 #include <cmath>
 #include <vector>
 #include <string>
@@ -22,7 +31,7 @@ public:
 
         if (!conversionTableFile.empty()) {
             if (!m_converter.loadFromFile(conversionTableFile)) {
-                std::cerr << "Error: Failed to load conversion table file.\n";
+                Log::error() << "Error: Failed to load conversion table file.";
             }
         }
 
@@ -30,28 +39,69 @@ public:
     }
 
     void convert() {
-        // 1. 读取 GZIP 压缩的 NBT
+        // 1. 以拉取模式流式读取 GZIP 压缩的 NBT
+        // 不构建完整的标签树: BlockStates 长数组分块直接送入解码器,
+        // PreviewImageData / Entities / PendingBlockTicks 等不用的键直接跳过
         std::ifstream file(m_filename, std::ios::binary);
         if (!file) {
-            std::cerr << "无法打开文件: " << m_filename << std::endl;
+            Log::error() << "无法打开文件: " << m_filename;
             return;
         }
         zlib::izlibstream gzFile(file);
-        auto [rootName, nbtRoot] = nbt::io::read_compound(gzFile);
-
-        // 2. 读取 Metadata 信息
-        if (!nbtRoot->has_key("Metadata") || !nbtRoot->has_key("Regions")) {
-            std::cerr << "错误: 文件不是有效的 Litematic (缺少 Metadata 或 Regions)" << std::endl;
+        nbt::io::stream_reader reader(gzFile);
+        if (reader.read_type() != nbt::tag_type::Compound) {
+            Log::error() << "错误: 文件不是有效的 Litematic (根标签不是 Compound)";
             return;
         }
+        reader.read_string();
+
+        // 创建 BCFCachedWriter
+        BCFCachedWriter writer(m_outputFilename, "./temp_bcf_cache", 50000);
+
+        nbt::tag_compound meta;
+        bool hasMetadata = false, hasRegions = false, hasPreview = false;
+        int lm_version = 0, lm_subversion = 0, mc_version = 0;
+        std::vector<RegionBounds> regionBounds;
+
+        // 2. 读取根标签: Metadata / Regions / 版本号
+        nbt::tag_type type;
+        std::string key;
+        while (reader.read_compound_entry(type, key)) {
+            if (key == "Metadata" && type == nbt::tag_type::Compound) {
+                hasMetadata = true;
+                hasPreview = readMetadata(reader, meta);
+            }
+            else if (key == "Regions" && type == nbt::tag_type::Compound) {
+                hasRegions = true;
+                // 3. 逐个 Region 流式处理
+                while (reader.read_compound_entry(type, key)) {
+                    if (type != nbt::tag_type::Compound) {
+                        reader.skip_payload(type);
+                        continue;
+                    }
+                    RegionBounds bounds;
+                    if (processRegion(reader, writer, bounds))
+                        regionBounds.push_back(bounds);
+                }
+            }
+            else if (key == "Version" || key == "SubVersion" || key == "MinecraftDataVersion") {
+                int v = static_cast<int>(nbt::value(reader.read_payload(type)));
+                if (key == "Version") lm_version = v;
+                else if (key == "SubVersion") lm_subversion = v;
+                else mc_version = v;
+            }
+            else {
+                reader.skip_payload(type);
+            }
+        }
 
-        const auto& meta = nbtRoot->at("Metadata").as<nbt::tag_compound>();
+        if (!hasMetadata || !hasRegions) {
+            Log::error() << "错误: 文件不是有效的 Litematic (缺少 Metadata 或 Regions)";
+            return;
+        }
 
-        int lm_version = static_cast<int>(nbtRoot->at("Version"));
-        int lm_subversion = nbtRoot->has_key("SubVersion")
-            ? static_cast<int>(nbtRoot->at("SubVersion"))
-            : 0;
-        int mc_version = static_cast<int>(nbtRoot->at("MinecraftDataVersion"));
+        Log::debug() << "Litematic Version " << lm_version << "." << lm_subversion << ", MinecraftDataVersion " << mc_version;
+        int regionCount = static_cast<int>(regionBounds.size());
 
         // 读取尺寸
         const auto& encSize = meta.at("EnclosingSize").as<nbt::tag_compound>();
@@ -63,174 +113,434 @@ public:
         std::string name = static_cast<std::string>(meta.at("Name"));
         std::string desc = static_cast<std::string>(meta.at("Description"));
 
-        // 创建 BCFCachedWriter
-        BCFCachedWriter writer(m_outputFilename, "./temp_bcf_cache", 50000);
-
-        // 3. 读取 Regions
-        auto& regions = nbtRoot->at("Regions").as<nbt::tag_compound>();
-        int regionCount = static_cast<int>(regions.size());
-
-        for (const auto& [regionName, regionTag] : regions) {
-            processRegion(regionTag.as<nbt::tag_compound>(), writer);
-        }
-
         // 校验 RegionCount
         if (meta.has_key("RegionCount")) {
             int expectedCount = static_cast<int>(meta.at("RegionCount"));
             if (expectedCount != regionCount) {
-                std::cerr << "警告: RegionCount 不匹配, 预期 " << expectedCount
-                    << " 实际 " << regionCount << std::endl;
+                Log::warn() << "警告: RegionCount 不匹配, 预期 " << expectedCount
+                    << " 实际 " << regionCount;
             }
         }
 
         // 校验尺寸
         if (meta.has_key("EnclosingSize")) {
             int calcW = 0, calcH = 0, calcL = 0;
-            for (const auto& [regionName, regionTag] : regions) {
-                const auto& region = regionTag.as<nbt::tag_compound>();
-                const auto& size = region.at("Size").as<nbt::tag_compound>();
-                const auto& pos = region.at("Position").as<nbt::tag_compound>();
-                calcW = std::max(calcW, static_cast<int>(pos.at("x")) + static_cast<int>(size.at("x")));
-                calcH = std::max(calcH, static_cast<int>(pos.at("y")) + static_cast<int>(size.at("y")));
-                calcL = std::max(calcL, static_cast<int>(pos.at("z")) + static_cast<int>(size.at("z")));
+            for (const auto& b : regionBounds) {
+                calcW = std::max(calcW, b.posX + b.sizeX);
+                calcH = std::max(calcH, b.posY + b.sizeY);
+                calcL = std::max(calcL, b.posZ + b.sizeZ);
             }
 
             if (calcW != width || calcH != height || calcL != length) {
-                std::cerr << "错误: Metadata 尺寸与实际区域尺寸不匹配\n"
+                Log::error() << "错误: Metadata 尺寸与实际区域尺寸不匹配\n"
                     << "  Metadata: (" << width << ", " << height << ", " << length << ")\n"
-                    << "  实际计算: (" << calcW << ", " << calcH << ", " << calcL << ")\n";
+                    << "  实际计算: (" << calcW << ", " << calcH << ", " << calcL << ")";
             }
         }
 
         // 设置时间信息（非必要，仅打印）
         if (meta.has_key("TimeCreated"))
-            std::cout << "TimeCreated: " << static_cast<int64_t>(meta.at("TimeCreated")) << "\n";
+            Log::info() << "TimeCreated: " << static_cast<int64_t>(meta.at("TimeCreated"));
         if (meta.has_key("TimeModified"))
-            std::cout << "TimeModified: " << static_cast<int64_t>(meta.at("TimeModified")) << "\n";
+            Log::info() << "TimeModified: " << static_cast<int64_t>(meta.at("TimeModified"));
 
-        if (meta.has_key("PreviewImageData"))
-            std::cout << "包含预览图像数据 (忽略)" << std::endl;
+        if (hasPreview)
+            Log::info() << "包含预览图像数据 (忽略)";
 
         // 4. 完成写入
         writer.finalize();
 
-        std::cout << "✅ Litematic 转换完成: " << name << " by " << author << std::endl;
+        m_converter.reportMissing();
+        Log::info() << "✅ Litematic 转换完成: " << name << " by " << author;
     }
 
 private:
-    // region 解码逻辑与原代码一致
-    void processRegion(const nbt::tag_compound& region, BCFCachedWriter& writer) {
-        const auto& size = region.at("Size").as<nbt::tag_compound>();
-        int sizeX = static_cast<int>(size.at("x").as<nbt::tag_int>());
-        int sizeY = static_cast<int>(size.at("y").as<nbt::tag_int>());
-        int sizeZ = static_cast<int>(size.at("z").as<nbt::tag_int>());
+    static constexpr PaletteID AIR_ENTRY = ~PaletteID(0);
+    static constexpr PaletteID UNRESOLVED_ENTRY = AIR_ENTRY - 1;
+
+    // 读取 TileEntities 列表, 每个 Region 只建一次位置表 (局部坐标, 相对修正负尺寸后的最小角)。
+    // 去掉 x/y/z 坐标键: 内容相同的方块实体可以共用 palette 条目, 坐标由方块位置决定。
+    static BlockEntityMap readTileEntities(nbt::io::stream_reader& reader, nbt::tag_type type) {
+        BlockEntityMap map;
+        forEachTileEntity(reader, type, [&](int x, int y, int z, std::shared_ptr<nbt::tag_compound> nbtData) {
+            map[blockPositionKey(x, y, z)] = std::move(nbtData);
+        });
+        return map;
+    }
+
+    // 逐个取出 TileEntities 列表中的方块实体 (局部坐标 + 去掉坐标键的 NBT)
+    template<typename Fn>
+    static void forEachTileEntity(nbt::io::stream_reader& reader, nbt::tag_type type, Fn&& fn) {
+        auto tag = reader.read_payload(type);
+        auto& list = tag->as<nbt::tag_list>();
+        if (list.el_type() != nbt::tag_type::Compound) return;
+        for (auto& entry : list) {
+            auto& te = entry.as<nbt::tag_compound>();
+            if (!te.has_key("x", nbt::tag_type::Int) || !te.has_key("y", nbt::tag_type::Int)
+                || !te.has_key("z", nbt::tag_type::Int)) {
+                continue;
+            }
+            int x = static_cast<int>(te.at("x"));
+            int y = static_cast<int>(te.at("y"));
+            int z = static_cast<int>(te.at("z"));
+            auto nbtData = std::make_shared<nbt::tag_compound>(std::move(te));
+            nbtData->erase("x");
+            nbtData->erase("y");
+            nbtData->erase("z");
+            fn(x, y, z, std::move(nbtData));
+        }
+    }
 
+    // Region 的原始位置与尺寸 (未修正负尺寸), 用于校验 EnclosingSize
+    struct RegionBounds {
+        int posX = 0, posY = 0, posZ = 0;
+        int sizeX = 0, sizeY = 0, sizeZ = 0;
+    };
+
+    // 读取 Metadata, 跳过 PreviewImageData; 返回是否包含预览图
+    bool readMetadata(nbt::io::stream_reader& reader, nbt::tag_compound& meta) {
+        bool hasPreview = false;
+        nbt::tag_type type;
+        std::string key;
+        while (reader.read_compound_entry(type, key)) {
+            if (key == "PreviewImageData") {
+                hasPreview = true;
+                reader.skip_payload(type);
+            }
+            else {
+                meta.put(key, reader.read_payload(type));
+            }
+        }
+        return hasPreview;
+    }
 
+    static void readVec3(nbt::io::stream_reader& reader, nbt::tag_type type, int& x, int& y, int& z) {
+        auto tag = reader.read_payload(type);
+        const auto& comp = tag->as<nbt::tag_compound>();
+        x = static_cast<int>(comp.at("x").as<nbt::tag_int>());
+        y = static_cast<int>(comp.at("y").as<nbt::tag_int>());
+        z = static_cast<int>(comp.at("z").as<nbt::tag_int>());
+    }
 
-        const auto& position = region.at("Position").as<nbt::tag_compound>();
-        int posX = static_cast<int>(position.at("x").as<nbt::tag_int>());
-        int posY = static_cast<int>(position.at("y").as<nbt::tag_int>());
-        int posZ = static_cast<int>(position.at("z").as<nbt::tag_int>());
+    // 流式处理单个 Region; 返回是否读到了 Size 与 Position
+    bool processRegion(nbt::io::stream_reader& reader, BCFCachedWriter& writer, RegionBounds& bounds) {
+        bool hasSize = false, hasPosition = false, hasPalette = false, decoded = false;
+        nbt::tag_list palette;
+        std::vector<PaletteID> paletteTable;
+        BlockEntityMap tileEntities;
+        // BlockStates 出现在 Size/Position/Palette 之前时只能先缓存
+        // (Litematica 按 HashMap 顺序写键, 实际文件中 BlockStates 通常排在最前)。
+        // TileEntities 不必等待: 在 BlockStates 之后出现时用 attachBlockNBT 补到已写入的方块上。
+        std::vector<int64_t> pendingStates;
+        bool hasPendingStates = false;
+
+        nbt::tag_type type;
+        std::string key;
+        while (reader.read_compound_entry(type, key)) {
+            if (key == "Size" && type == nbt::tag_type::Compound) {
+                readVec3(reader, type, bounds.sizeX, bounds.sizeY, bounds.sizeZ);
+                hasSize = true;
+            }
+            else if (key == "Position" && type == nbt::tag_type::Compound) {
+                readVec3(reader, type, bounds.posX, bounds.posY, bounds.posZ);
+                hasPosition = true;
+            }
+            else if (key == "BlockStatePalette" && type == nbt::tag_type::List) {
+                palette = std::move(reader.read_payload(type)->as<nbt::tag_list>());
+                paletteTable = buildPaletteTable(palette);
+                hasPalette = true;
+            }
+            else if (key == "TileEntities" && type == nbt::tag_type::List) {
+                if (decoded) {
+                    RegionLayout layout = layoutOf(bounds);
+                    forEachTileEntity(reader, type, [&](int x, int y, int z, std::shared_ptr<nbt::tag_compound> nbtData) {
+                        writer.attachBlockNBT(layout.posX + x, layout.posY + y, layout.posZ + z, std::move(nbtData));
+                    });
+                }
+                else {
+                    tileEntities = readTileEntities(reader, type);
+                }
+            }
+            else if (key == "BlockStates" && type == nbt::tag_type::Long_Array) {
+                int32_t longCount = reader.read_array_length();
+                if (hasSize && hasPosition && hasPalette) {
+                    emitRegion(bounds, palette, paletteTable, tileEntities, writer, longCount,
+                        [&](int64_t* buf, size_t n) { reader.read_array_data(buf, n); });
+                    decoded = true;
+                }
+                else {
+                    pendingStates.resize(static_cast<size_t>(longCount));
+                    reader.read_array_data(pendingStates.data(), pendingStates.size());
+                    hasPendingStates = true;
+                }
+            }
+            else {
+                // Entities / PendingBlockTicks / PendingFluidTicks 等 (BCF 不保存实体与计划刻)
+                reader.skip_payload(type);
+            }
+        }
+
+        if (!hasSize || !hasPosition || !hasPalette) {
+            Log::error() << "错误: Region 缺少 Size、Position 或 BlockStatePalette, 已跳过";
+            return hasSize && hasPosition;
+        }
+        if (hasPendingStates && !decoded) {
+            size_t consumed = 0;
+            emitRegion(bounds, palette, paletteTable, tileEntities, writer, static_cast<int32_t>(pendingStates.size()),
+                [&](int64_t* buf, size_t n) {
+                    std::copy(pendingStates.begin() + consumed, pendingStates.begin() + consumed + n, buf);
+                    consumed += n;
+                });
+            decoded = true;
+        }
+        if (!decoded)
+            Log::error() << "错误: Region 缺少 BlockStates";
+        return true;
+    }
+
+    // 按 Y 分层并行解码: 每层约 SLAB_BLOCKS 个方块, 同时在途的层数不超过线程数
+    static constexpr int64_t SLAB_BLOCKS = int64_t(1) << 18;
+    static constexpr unsigned MAX_DECODE_THREADS = 8;
+    static constexpr size_t CHUNK_LONGS = 8192;
+
+    // 修正负尺寸后的 Region 几何与位宽, 工作线程只读
+    struct RegionLayout {
+        int posX = 0, posY = 0, posZ = 0;
+        int sizeX = 0, sizeY = 0, sizeZ = 0;
+        int paletteSize = 0;
+        int bitsPerBlock = 1;
+        int64_t actualBlocks = 0;
+        int worldMinY = 0;          // writer 的 Y 基准, 用于新建分片
+    };
+
+    // 一个分层任务: [yBegin, yEnd) 层, words 从第一个条目所在的 64 条目块开始
+    struct SlabJob {
+        int yBegin = 0, yEnd = 0;
+        std::vector<int64_t> words;
+    };
+
+    // 分层解码结果: 分片中的 PaletteID 暂用 Region palette 索引, 带方块实体的方块用 paletteSize + 序号;
+    // events 按方块顺序记录需要注册的条目 (普通索引首次出现, 以及每个带方块实体的方块)
+    struct SlabResult {
+        BCFCachedWriter::Shard shard;
+        std::vector<std::pair<int, std::shared_ptr<nbt::tag_compound>>> events;
+    };
+
+    static RegionLayout layoutOf(const RegionBounds& bounds) {
+        RegionLayout layout;
+        layout.sizeX = bounds.sizeX; layout.sizeY = bounds.sizeY; layout.sizeZ = bounds.sizeZ;
+        layout.posX = bounds.posX; layout.posY = bounds.posY; layout.posZ = bounds.posZ;
         // ✅ 修正负尺寸
-        if (sizeX < 0) { posX += sizeX; sizeX = -sizeX; }
-        if (sizeY < 0) { posY += sizeY; sizeY = -sizeY; }
-        if (sizeZ < 0) { posZ += sizeZ; sizeZ = -sizeZ; }
-        const auto& palette = region.at("BlockStatePalette").as<nbt::tag_list>();
-        int paletteSize = static_cast<int>(palette.size());
-        std::vector<bool> isAirPalette = buildAirFilter(palette);
-
-        const auto& blockStates = region.at("BlockStates").as<nbt::tag_long_array>();
-        int bitsPerBlock = paletteSize > 1 ? static_cast<int>(std::ceil(std::log2(paletteSize))) : 1;
-        int blocksPerLong = 64 / bitsPerBlock;
-        int maxDecodableBlocks = static_cast<int>(blockStates.size()) * blocksPerLong;
-        int totalBlocks = sizeX * sizeY * sizeZ;
-        int actualBlocks = std::min(totalBlocks, maxDecodableBlocks);
-
-        std::vector<int> blockIndices = decodeBlockStates(blockStates, actualBlocks, bitsPerBlock);
-        if (blockIndices.size() < static_cast<size_t>(totalBlocks))
-            blockIndices.resize(totalBlocks, 0);
-        std::cout << "[DEBUG] Region pos=(" << posX << "," << posY << "," << posZ << ") size=(" << sizeX << "," << sizeY << "," << sizeZ << ")\n";
-        int count = 0;
-        for (int y = 0; y < sizeY; ++y) {
-            for (int z = 0; z < sizeZ; ++z) {
-                for (int x = 0; x < sizeX; ++x) {
-                    // Litemapy index 计算方式
-                    int index = x + (z * sizeX) + (y * sizeX * sizeZ);
-                    int paletteIndex = blockIndices[index];
-
-                    // 在满足条件之前打印前10个有效点
-                    if (count < 10) {
-                        std::cout << "x: " << x << ", y: " << y << ", z: " << z << ", paletteIndex: " << paletteIndex << std::endl;
-                        count++;
-                    }
+        if (layout.sizeX < 0) { layout.posX += layout.sizeX; layout.sizeX = -layout.sizeX; }
+        if (layout.sizeY < 0) { layout.posY += layout.sizeY; layout.sizeY = -layout.sizeY; }
+        if (layout.sizeZ < 0) { layout.posZ += layout.sizeZ; layout.sizeZ = -layout.sizeZ; }
+        return layout;
+    }
 
-                    if (paletteIndex < 0 || paletteIndex >= paletteSize || isAirPalette[paletteIndex])
-                        continue;
+    static unsigned decodeThreads() {
+        unsigned hw = std::thread::hardware_concurrency();
+        return std::max(1u, std::min(hw, MAX_DECODE_THREADS));
+    }
 
-                    auto& block = palette.at(paletteIndex).as<nbt::tag_compound>();
-                    std::string blockName = static_cast<std::string>(block.at("Name"));
+    // 边读边解码: readLongs(buf, n) 提供下一段长数组。
+    // 主线程按层切出长数组交给工作线程解码到各自的分片, 再按层的顺序注册 palette 并入 writer,
+    // palette 注册顺序与方块写入顺序都与逐个方块处理时相同。
+    template<typename ReadLongs>
+    void emitRegion(const RegionBounds& bounds, const nbt::tag_list& palette,
+        std::vector<PaletteID>& paletteTable, const BlockEntityMap& tileEntities, BCFCachedWriter& writer,
+        int32_t longCount, ReadLongs&& readLongs) {
+        RegionLayout layout = layoutOf(bounds);
+        layout.worldMinY = writer.minWorldY();
+        layout.paletteSize = static_cast<int>(palette.size());
+        layout.bitsPerBlock = layout.paletteSize > 1 ? static_cast<int>(std::ceil(std::log2(layout.paletteSize))) : 1;
+        int blocksPerLong = 64 / layout.bitsPerBlock;
+        int64_t maxDecodableBlocks = static_cast<int64_t>(longCount) * blocksPerLong;
+        int64_t layerBlocks = static_cast<int64_t>(layout.sizeX) * layout.sizeZ;
+        int64_t totalBlocks = layerBlocks * layout.sizeY;
+        layout.actualBlocks = std::min(totalBlocks, maxDecodableBlocks);
+
+        Log::debug() << "Region pos=(" << layout.posX << "," << layout.posY << "," << layout.posZ << ") size=("
+            << layout.sizeX << "," << layout.sizeY << "," << layout.sizeZ << ")";
+
+        // 工作线程不能读正在被主线程填写的 paletteTable, 空气标记单独复制一份
+        std::vector<uint8_t> isAir(paletteTable.size());
+        for (size_t i = 0; i < paletteTable.size(); i++) isAir[i] = paletteTable[i] == AIR_ENTRY;
+
+        // 已读入、还可能被后续层用到的长数组; buffer[0] 对应长数组下标 bufferBase
+        const size_t totalLongs = static_cast<size_t>(longCount);
+        std::vector<int64_t> buffer;
+        size_t bufferBase = 0, readCount = 0;
+        const size_t bits = static_cast<size_t>(layout.bitsPerBlock);
+        auto blockStartWord = [&](int64_t entry) {
+            return std::min(totalLongs, static_cast<size_t>(entry / 64) * bits);
+        };
+
+        const int slabLayers = static_cast<int>(std::max<int64_t>(1,
+            std::min<int64_t>(layout.sizeY, SLAB_BLOCKS / std::max<int64_t>(1, layerBlocks))));
+        int nextY = 0;
+        auto nextJob = [&]() {
+            SlabJob job;
+            job.yBegin = nextY;
+            job.yEnd = std::min(layout.sizeY, nextY + slabLayers);
+            nextY = job.yEnd;
+
+            int64_t eBegin = job.yBegin * layerBlocks, eEnd = job.yEnd * layerBlocks;
+            size_t wBegin = blockStartWord(eBegin);
+            size_t wEnd = std::min(totalLongs, static_cast<size_t>((eEnd * layout.bitsPerBlock + 63) / 64));
+            while (readCount < wEnd) {
+                size_t n = std::min(wEnd - readCount, CHUNK_LONGS);
+                buffer.resize(buffer.size() + n);
+                readLongs(buffer.data() + buffer.size() - n, n);
+                readCount += n;
+            }
+            job.words.assign(buffer.begin() + static_cast<std::ptrdiff_t>(wBegin - bufferBase),
+                buffer.begin() + static_cast<std::ptrdiff_t>(wEnd - bufferBase));
+
+            // 下一层从 eEnd 所在的块开始, 之前的长数组不再需要
+            size_t keepFrom = std::max(bufferBase, blockStartWord(eEnd));
+            buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(keepFrom - bufferBase));
+            bufferBase = keepFrom;
+            return job;
+        };
+
+        std::vector<PaletteID> entityIds;
+        auto mergeSlab = [&](SlabResult result) {
+            entityIds.clear();
+            for (auto& [paletteIndex, nbtData] : result.events) {
+                if (nbtData)
+                    entityIds.push_back(translatePaletteEntry(palette, paletteIndex, writer, std::move(nbtData)));
+                else if (paletteTable[paletteIndex] == UNRESOLVED_ENTRY)
+                    paletteTable[paletteIndex] = translatePaletteEntry(palette, paletteIndex, writer);
+            }
+            const PaletteID paletteSize = static_cast<PaletteID>(layout.paletteSize);
+            result.shard.remapPalette([&](PaletteID id) {
+                return id < paletteSize ? paletteTable[id] : entityIds[id - paletteSize];
+            });
+            writer.addShard(std::move(result.shard));
+        };
+
+        const size_t window = decodeThreads();
+        const auto policy = window > 1 ? std::launch::async : std::launch::deferred;
+        std::deque<std::future<SlabResult>> pending;
+        auto launchNext = [&]() {
+            pending.push_back(std::async(policy,
+                [&layout, &isAir, &tileEntities, job = nextJob()]() mutable {
+                    return decodeSlab(layout, isAir, tileEntities, std::move(job));
+                }));
+        };
+        while (nextY < layout.sizeY && pending.size() < window) launchNext();
+
+        while (!pending.empty()) {
+            SlabResult result = pending.front().get();
+            pending.pop_front();
+            if (nextY < layout.sizeY) launchNext();
+            mergeSlab(std::move(result));
+        }
 
-                    std::vector<std::pair<std::string, std::string>> statesVec;
-                    if (block.has_key("Properties")) {
-                        statesVec = extractBlockStates(block.at("Properties").as<nbt::tag_compound>());
-                    }
+        // 长数组多出的部分也要从流中读掉
+        std::vector<int64_t> chunk(std::min(CHUNK_LONGS, totalLongs - readCount));
+        while (readCount < totalLongs) {
+            size_t n = std::min(totalLongs - readCount, chunk.size());
+            readLongs(chunk.data(), n);
+            readCount += n;
+        }
+    }
 
-                    auto [beBlockName, beStates] = m_converter.convert(blockName, statesVec);
+    // 解码一层到分片; 只读 layout / isAir / tileEntities, 可在工作线程中并行调用
+    static SlabResult decodeSlab(const RegionLayout& layout, const std::vector<uint8_t>& isAir,
+        const BlockEntityMap& tileEntities, SlabJob job) {
+        SlabResult result{ BCFCachedWriter::Shard(layout.worldMinY), {} };
+        const int sizeX = layout.sizeX, sizeZ = layout.sizeZ;
+        PackedBitArrayDecoder decoder(layout.bitsPerBlock);
+        decoder.feed(job.words.data(), job.words.size());
+        job.words = std::vector<int64_t>();
+
+        // Litemapy 索引顺序: index = x + z * sizeX + y * sizeX * sizeZ, 每次解码一行 (固定 y, z)
+        std::vector<uint16_t> row(static_cast<size_t>(sizeX));
+        int64_t index = static_cast<int64_t>(job.yBegin) * sizeX * sizeZ;
+        // words 从块边界开始: 先丢掉块内位于本层之前的条目
+        for (size_t skip = static_cast<size_t>(index % 64); skip > 0;) {
+            size_t n = decoder.decode(row.data(), std::min(skip, row.size()));
+            if (n == 0) break;
+            skip -= n;
+        }
+
+        std::vector<uint8_t> seen(isAir.size());
+        PaletteID entityCount = 0;
+        [[maybe_unused]] int count = 0;
+        for (int y = job.yBegin; y < job.yEnd; ++y) {
+            for (int z = 0; z < sizeZ; ++z) {
+                size_t got = decoder.decode(row.data(), row.size());
+                // 长数组不足时剩余方块视为索引 0
+                std::fill(row.begin() + got, row.end(), uint16_t(0));
+                // 超出可解码范围的方块按索引 0 处理
+                for (int64_t i = std::max<int64_t>(layout.actualBlocks - index, 0); i < sizeX; ++i)
+                    row[static_cast<size_t>(i)] = 0;
+
+                for (int x = 0; x < sizeX; ++x) {
+                    int paletteIndex = row[x];
+
+                    // 调试: 打印每个 Region 的前 10 个点 (Release 中整体编译掉)
+                    if constexpr (Log::DEBUG_ENABLED) {
+                        if (job.yBegin == 0 && count < 10) {
+                            Log::debug() << "x: " << x << ", y: " << y << ", z: " << z << ", paletteIndex: " << paletteIndex;
+                            count++;
+                        }
+                    }
 
-                    writer.addBlock(posX + x, posY + y, posZ + z, beBlockName, beStates);
+                    if (paletteIndex >= layout.paletteSize || isAir[paletteIndex]) continue;
+                    int wx = layout.posX + x, wy = layout.posY + y, wz = layout.posZ + z;
+
+                    // 带方块实体的方块单独注册 (类型+状态+NBT), 其余按翻译表写入
+                    if (!tileEntities.empty()) {
+                        auto it = tileEntities.find(blockPositionKey(x, y, z));
+                        if (it != tileEntities.end()) {
+                            result.events.emplace_back(paletteIndex, it->second);
+                            result.shard.addBlock(wx, wy, wz, static_cast<PaletteID>(layout.paletteSize) + entityCount++);
+                            continue;
+                        }
+                    }
+                    if (!seen[paletteIndex]) {
+                        seen[paletteIndex] = 1;
+                        result.events.emplace_back(paletteIndex, nullptr);
+                    }
+                    result.shard.addBlock(wx, wy, wz, static_cast<PaletteID>(paletteIndex));
                 }
+                index += sizeX;
             }
         }
+        return result;
     }
 
-    std::vector<bool> buildAirFilter(const nbt::tag_list& palette) {
-        std::vector<bool> isAir(palette.size(), false);
+    // Region palette -> writer PaletteID 翻译表; 空气条目标记为 AIR_ENTRY,
+    // 其余条目在首次出现时才翻译并注册, 未使用的条目不会写入 BCF palette
+    std::vector<PaletteID> buildPaletteTable(const nbt::tag_list& palette) {
+        std::vector<PaletteID> table(palette.size(), UNRESOLVED_ENTRY);
         for (size_t i = 0; i < palette.size(); i++) {
             auto& block = palette.at(i).as<nbt::tag_compound>();
             std::string name = static_cast<std::string>(block.at("Name"));
             if (name.find("air") != std::string::npos)
-                isAir[i] = true;
+                table[i] = AIR_ENTRY;
         }
-        return isAir;
+        return table;
     }
 
+    // 每个 palette 条目只做一次 (带方块实体的方块除外): 取名称和状态, 经转换表转为基岩版后注册
+    PaletteID translatePaletteEntry(const nbt::tag_list& palette, int paletteIndex, BCFCachedWriter& writer,
+        std::shared_ptr<nbt::tag_compound> nbtData = nullptr) {
+        auto& block = palette.at(paletteIndex).as<nbt::tag_compound>();
+        std::string blockName = static_cast<std::string>(block.at("Name"));
 
-    std::vector<int> decodeBlockStates(
-        const nbt::tag_long_array& blockStates,
-        int totalBlocks,
-        int bitsPerBlock
-    ) {
-        std::vector<int> indices;
-        indices.reserve(totalBlocks);
-
-        if (bitsPerBlock <= 0) bitsPerBlock = 1;
-        const uint64_t mask = (1ULL << bitsPerBlock) - 1ULL;
-        const size_t longsCount = blockStates.size();
-
-        for (int i = 0; i < totalBlocks; ++i) {
-            uint64_t bitIndex = static_cast<uint64_t>(i) * bitsPerBlock;
-            size_t longIndex = bitIndex / 64;
-            uint32_t bitOffset = bitIndex % 64;
-
-            if (longIndex >= longsCount) {
-                indices.push_back(0);
-                continue;
-            }
-
-            // 注意：不要 byteswap，也不要 bit reverse
-            uint64_t value = static_cast<uint64_t>(blockStates[longIndex]) >> bitOffset;
-
-            // 跨 long 拼接
-            if (bitOffset + bitsPerBlock > 64 && longIndex + 1 < longsCount) {
-                uint64_t next = static_cast<uint64_t>(blockStates[longIndex + 1]);
-                value |= (next << (64 - bitOffset));
-            }
-
-            indices.push_back(static_cast<int>(value & mask));
+        std::vector<std::pair<std::string, std::string>> statesVec;
+        if (block.has_key("Properties")) {
+            statesVec = extractBlockStates(block.at("Properties").as<nbt::tag_compound>());
         }
 
-        return indices;
+        auto [beBlockName, beStates] = m_converter.convert(blockName, statesVec);
+        return writer.registerPalette(beBlockName, beStates, std::move(nbtData));
     }
+
+
     std::vector<std::pair<std::string, std::string>> extractBlockStates(const nbt::tag_compound& properties) {
         std::vector<std::pair<std::string, std::string>> states;
         states.reserve(properties.size());
@@ -1,5 +1,6 @@
 #pragma once  
 #include "Writer/BCFCachedWriter.hpp"  
+#include "core/Log.hpp"
 #include <fstream>  
 #include <sstream>  
 #include <string>  
@@ -20,16 +21,18 @@ public:
     void convert() {
         std::ifstream file(m_filename);
         if (!file) {
-            throw std::runtime_error("޷ļ: " + m_filename);
+            throw std::runtime_error("无法打开文件: " + m_filename);
         }
 
         BCFCachedWriter writer(m_outputFilename, "./temp_bcf_cache", 50000);
 
         std::string line;
         int lineNum = 0;
+        // 出错的行可能很多, 只逐条输出前 100 条, 其余汇总
+        LogLimiter parseErrors(100);
         while (std::getline(file, line)) {
             lineNum++;
-            // кע  
+            // 跳过空行和注释  
             if (line.empty() || line[0] == '#') {
                 continue;
             }
@@ -38,9 +41,12 @@ public:
                 parseLine(line, writer);
             }
             catch (const std::exception& e) {
-                std::cerr << " " << lineNum << " н: " << e.what() << std::endl;
+                if (parseErrors.allow())
+                    Log::warn() << "第 " << lineNum << " 行解析错误: " << e.what();
             }
         }
+        if (parseErrors.suppressed())
+            Log::warn() << "另有 " << parseErrors.suppressed() << " 行解析错误未显示 (共 " << parseErrors.total() << " 行)";
 
         writer.finalize();
     }
@@ -57,17 +63,17 @@ private:
         else if (command == "fill" || command == "/fill") {
             parseFill(iss, writer);
         }
-        // ָ  
+        // 忽略其他指令  
     }
 
-    // ַ, ~  ^   
+    // 解析坐标字符串,忽略 ~ 和 ^ 符号  
     int parseCoord(const std::string& coordStr) {
         std::string cleaned = coordStr;
-        // Ƴ ~  ^   
+        // 移除 ~ 和 ^ 符号  
         cleaned.erase(std::remove(cleaned.begin(), cleaned.end(), '~'), cleaned.end());
         cleaned.erase(std::remove(cleaned.begin(), cleaned.end(), '^'), cleaned.end());
 
-        // Ϊַ, 0  
+        // 如果清理后为空字符串,返回 0  
         if (cleaned.empty()) {
             return 0;
         }
@@ -79,7 +85,7 @@ private:
         std::string xStr, yStr, zStr, blockStr;
 
         if (!(iss >> xStr >> yStr >> zStr >> blockStr)) {
-            throw std::runtime_error("setblock ָʽ");
+            throw std::runtime_error("setblock 指令格式错误");
         }
 
         int x = parseCoord(xStr);
@@ -94,7 +100,7 @@ private:
         std::string x1Str, y1Str, z1Str, x2Str, y2Str, z2Str, blockStr;
 
         if (!(iss >> x1Str >> y1Str >> z1Str >> x2Str >> y2Str >> z2Str >> blockStr)) {
-            throw std::runtime_error("fill ָʽ");
+            throw std::runtime_error("fill 指令格式错误");
         }
 
         int x1 = parseCoord(x1Str);
@@ -106,12 +112,12 @@ private:
 
         auto [blockName, states] = parseBlockNameAndStates(blockStr);
 
-        // ȷ˳ȷ  
+        // 确保坐标顺序正确  
         if (x1 > x2) std::swap(x1, x2);
         if (y1 > y2) std::swap(y1, y2);
         if (z1 > z2) std::swap(z1, z2);
 
-        //   
+        // 遍历矩形区域  
         for (int y = y1; y <= y2; y++) {
             for (int z = z1; z <= z2; z++) {
                 for (int x = x1; x <= x2; x++) {
@@ -141,7 +147,7 @@ private:
 
         std::string statesStr = fullName.substr(start, end - start);
 
-        // ָ  
+        // 分割逗号  
         size_t pos = 0;
         while (pos < statesStr.size()) {
             size_t commaPos = statesStr.find(',', pos);
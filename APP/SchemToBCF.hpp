@@ -1,10 +1,15 @@
 #pragma once    
 #include "Writer/BCFCachedWriter.hpp"  
 #include "core/BlockStateConverter.hpp"    
+#include "core/Log.hpp"
+#include "core/VarIntArray.hpp"
+#include "core/BlockEntityIndex.hpp"
 #include <nbt_tags.h>    
 #include <io/stream_reader.h>    
 #include <io/izlibstream.h>    
+#include <algorithm>
 #include <iostream>    
+#include <memory>
 #include <fstream>    
 #include <vector>    
 #include <string>    
@@ -15,12 +20,16 @@ private:
     const std::string m_filename;
     const std::string m_outputFilename;
     BlockStateConverter m_converter;  // 转换器成员  
+    const bool m_applyOffset;         // 写入坐标是否加上 Offset
 
 public:
     // 构造函数:支持可选的转换表文件  
+    // applyOffset: 按 Sponge 规范把 Offset 加到方块坐标上; 默认按局部坐标写入 (最小角在原点, 与旧版转换结果一致)。
+    // WorldEdit 导出的 v2 文件在 Offset 中保存世界坐标, 应用后可能超出 BCF 坐标范围
     SchemToBCF(const std::string& filename, const std::string& outputFilename,
-        const std::string& conversionTableFile = "D:\\Projects\\TemplateTool\\snbt_convert.txt")
-        : m_filename(filename), m_outputFilename(outputFilename) {
+        const std::string& conversionTableFile = "D:\\Projects\\TemplateTool\\snbt_convert.txt",
+        bool applyOffset = false)
+        : m_filename(filename), m_outputFilename(outputFilename), m_applyOffset(applyOffset) {
 
         // 如果提供了转换表文件,加载它  
         if (!conversionTableFile.empty()) {
@@ -36,120 +45,323 @@ public:
     void convert() {
         std::ifstream file(m_filename, std::ios::binary);
         if (!file) {
-            std::cerr << "无法打开文件" << std::endl;
+            Log::error() << "无法打开文件";
             return;
         }
 
         BCFCachedWriter writer(m_outputFilename, "./temp_bcf_cache", 50000);
 
         try {
-            // 读取并解压缩 GZIP 文件    
+            // 流式读取 GZIP 压缩的 NBT, 不构建完整标签树:
+            // BlockData 分块解码直接写入 writer, 不再生成每方块 4 字节的索引数组
             zlib::izlibstream gzstream(file);
-            auto [name, schematic] = nbt::io::read_compound(gzstream);
-
-            // 获取尺寸    
-            int16_t width = static_cast<int16_t>(schematic->at("Width"));
-            int16_t height = static_cast<int16_t>(schematic->at("Height"));
-            int16_t length = static_cast<int16_t>(schematic->at("Length"));
+            nbt::io::stream_reader reader(gzstream);
+            if (reader.read_type() != nbt::tag_type::Compound) {
+                Log::error() << "转换错误: 根标签不是 Compound";
+                return;
+            }
+            reader.read_string();
 
-            std::cout << "尺寸: " << width << "x" << height << "x" << length << std::endl;
+            SchematicState state;
+            readSchematic(reader, writer, state);
 
-            // 读取调色板 (Palette 是 tag_compound)    
-            auto& palette = schematic->at("Palette").as<nbt::tag_compound>();
+            if (!state.hasSize() || !state.hasPalette) {
+                Log::error() << "转换错误: 缺少 Width/Height/Length 或 Palette";
+                return;
+            }
+            Log::info() << "Sponge Schematic v" << state.version << ", 尺寸: "
+                << state.width << "x" << state.height << "x" << state.length
+                << ", 偏移: (" << state.offsetX << ", " << state.offsetY << ", " << state.offsetZ << ")";
+            if (!state.blockEntities.empty())
+                Log::info() << "方块实体: " << state.blockEntities.size() << " 个";
+
+            emitPending(state, writer);
+            if (!state.decoded) {
+                Log::error() << "转换错误: 缺少 BlockData";
+                return;
+            }
 
-            // 构建反向映射: 调色板ID -> 方块信息    
-            std::vector<std::pair<std::string, nbt::tag_compound*>> paletteMap;
-            int maxPaletteId = -1;
+            m_converter.reportMissing();
+            Log::info() << "转换完成!";
+            writer.finalize();
+            Log::info() << "写入文件完成!";
+        }
+        catch (const std::exception& e) {
+            Log::error() << "转换错误: " << e.what();
+            return;
+        }
+    }
 
-            for (const auto& [blockName, idTag] : palette) {
-                int paletteId = static_cast<int32_t>(idTag);
-                if (paletteId > maxPaletteId) {
-                    maxPaletteId = paletteId;
+private:
+    static constexpr PaletteID AIR_ENTRY = ~PaletteID(0);
+    static constexpr PaletteID UNRESOLVED_ENTRY = AIR_ENTRY - 1;
+
+    // 读取过程中收集的状态。v1/v2 的 Palette、BlockData、BlockEntities 在 Schematic 顶层,
+    // v3 放在 Blocks 容器中 (方块数据键名为 Data, 根标签下再包一层 Schematic)。
+    struct SchematicState {
+        int version = 0;
+        int width = -1, height = -1, length = -1;
+        int offsetX = 0, offsetY = 0, offsetZ = 0;
+        bool hasOffset = false;
+
+        bool hasPalette = false;
+        std::vector<std::string> paletteNames;
+        std::vector<PaletteID> paletteTable;
+
+        bool hasBlockEntities = false;
+        BlockEntityMap blockEntities;     // 按 schem 局部坐标索引
+
+        // 方块数据出现在尺寸、Palette、方块实体 (或需要应用的 Offset) 之前时只能先缓存原始字节 (每方块约 1 字节)
+        std::vector<int8_t> pendingData;
+        bool hasPendingData = false;
+        bool decoded = false;
+
+        bool hasSize() const { return width >= 0 && height >= 0 && length >= 0; }
+    };
+
+    void readSchematic(nbt::io::stream_reader& reader, BCFCachedWriter& writer, SchematicState& state) {
+        nbt::tag_type type;
+        std::string key;
+        while (reader.read_compound_entry(type, key)) {
+            if (key == "Schematic" && type == nbt::tag_type::Compound) {
+                readSchematic(reader, writer, state);      // v3: 根标签下的 Schematic
+            }
+            else if (key == "Version" && type == nbt::tag_type::Int) {
+                state.version = static_cast<int32_t>(nbt::value(reader.read_payload(type)));
+            }
+            else if ((key == "Width" || key == "Height" || key == "Length") && type == nbt::tag_type::Short) {
+                int v = static_cast<uint16_t>(static_cast<int16_t>(nbt::value(reader.read_payload(type))));
+                if (key == "Width") state.width = v;
+                else if (key == "Height") state.height = v;
+                else state.length = v;
+            }
+            else if (key == "Offset" && type == nbt::tag_type::Int_Array) {
+                int32_t count = reader.read_array_length();
+                int32_t offset[3] = { 0, 0, 0 };
+                size_t n = std::min<size_t>(3, static_cast<size_t>(count));
+                reader.read_array_data(offset, n);
+                reader.skip_array_data(static_cast<size_t>(count) - n, sizeof(int32_t));
+                state.offsetX = offset[0];
+                state.offsetY = offset[1];
+                state.offsetZ = offset[2];
+                state.hasOffset = true;
+            }
+            else if (key == "Blocks" && type == nbt::tag_type::Compound) {
+                // v3: 容器结束时方块实体已经读完, 尺寸 (及需要时的 Offset) 已知即可写出缓存的方块数据
+                while (reader.read_compound_entry(type, key)) {
+                    if (!readBlockContainerEntry(reader, writer, state, type, key, "Data"))
+                        reader.skip_payload(type);
                 }
+                state.hasBlockEntities = true;
+                if (state.hasSize() && offsetKnown(state)) emitPending(state, writer);
             }
+            else if (!readBlockContainerEntry(reader, writer, state, type, key, "BlockData")) {
+                // Metadata / Entities / Biomes 等 (BCF 不保存实体与生物群系)
+                reader.skip_payload(type);
+            }
+        }
+    }
 
-            paletteMap.resize(maxPaletteId + 1);
-
-            for (const auto& [blockName, idTag] : palette) {
-                int paletteId = static_cast<int32_t>(idTag);
-                paletteMap[paletteId] = { blockName, nullptr };
+    // Palette / 方块数据 / 方块实体; 返回 false 表示不是这几个键, 由调用方跳过
+    bool readBlockContainerEntry(nbt::io::stream_reader& reader, BCFCachedWriter& writer, SchematicState& state,
+        nbt::tag_type type, const std::string& key, const char* dataKey) {
+        if (key == "Palette" && type == nbt::tag_type::Compound) {
+            auto tag = reader.read_payload(type);
+            buildPaletteTable(tag->as<nbt::tag_compound>(), state.paletteNames, state.paletteTable);
+            state.hasPalette = true;
+        }
+        else if ((key == "BlockEntities" || key == "TileEntities") && type == nbt::tag_type::List) {
+            readBlockEntities(reader, type, state.blockEntities);
+            state.hasBlockEntities = true;
+        }
+        else if (key == dataKey && type == nbt::tag_type::Byte_Array) {
+            int32_t byteCount = reader.read_array_length();
+            Log::info() << "方块数据大小: " << byteCount << " 字节";
+            if (state.hasSize() && state.hasPalette && state.hasBlockEntities && offsetKnown(state) && !state.decoded) {
+                emitBlocks(state, writer, byteCount,
+                    [&](int8_t* buf, size_t n) { reader.read_array_data(buf, n); });
+                state.decoded = true;
+            }
+            else {
+                state.pendingData.resize(static_cast<size_t>(byteCount));
+                reader.read_array_data(state.pendingData.data(), state.pendingData.size());
+                state.hasPendingData = true;
             }
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
 
-            // 读取 BlockData (变长整数编码的调色板索引)    
-            auto& blockData = schematic->at("BlockData").as<nbt::tag_byte_array>();
-            std::cout << "方块数据大小: " << blockData.size() << " 字节" << std::endl;
+    // Offset 可以出现在方块数据之后 (v2 常见顺序 Palette, BlockEntities, BlockData, Offset);
+    // 需要应用时, 读到 Offset 或根标签结束之前不写出任何方块
+    bool offsetKnown(const SchematicState& state) const {
+        return !m_applyOffset || state.hasOffset;
+    }
 
-            // 预构建空气方块过滤器    
-            std::vector<bool> isAirPalette(paletteMap.size(), false);
-            for (size_t i = 0; i < paletteMap.size(); i++) {
-                if (paletteMap[i].first.find("air") != std::string::npos) {
-                    isAirPalette[i] = true;
-                }
+    // 写出缓存的方块数据 (尺寸和 Palette 必须已知)
+    void emitPending(SchematicState& state, BCFCachedWriter& writer) {
+        if (!state.hasPendingData || state.decoded || !state.hasPalette) return;
+        size_t consumed = 0;
+        emitBlocks(state, writer, static_cast<int32_t>(state.pendingData.size()),
+            [&](int8_t* buf, size_t n) {
+                std::copy(state.pendingData.begin() + consumed, state.pendingData.begin() + consumed + n, buf);
+                consumed += n;
+            });
+        state.decoded = true;
+        state.hasPendingData = false;
+        std::vector<int8_t>().swap(state.pendingData);
+    }
+
+    // 读取方块实体列表, 按局部坐标建表。
+    // v2: { Pos, Id, 其余字段 }; v3: { Pos, Id, Data: { 字段 } }; v1 的 TileEntities 与 v2 相同。
+    // 去掉坐标, 统一为带 id 的 Java 方块实体 NBT: 内容相同的方块实体可以共用 palette 条目。
+    static void readBlockEntities(nbt::io::stream_reader& reader, nbt::tag_type type, BlockEntityMap& map) {
+        auto tag = reader.read_payload(type);
+        auto& list = tag->as<nbt::tag_list>();
+        if (list.el_type() != nbt::tag_type::Compound) return;
+        map.reserve(map.size() + list.size());
+        for (auto& entry : list) {
+            auto& be = entry.as<nbt::tag_compound>();
+            if (!be.has_key("Pos", nbt::tag_type::Int_Array)) continue;
+            const auto& pos = be.at("Pos").as<nbt::tag_int_array>();
+            if (pos.size() < 3) continue;
+            int x = pos[0], y = pos[1], z = pos[2];
+
+            std::string id;
+            if (be.has_key("Id", nbt::tag_type::String)) id = static_cast<std::string>(be.at("Id"));
+            else if (be.has_key("id", nbt::tag_type::String)) id = static_cast<std::string>(be.at("id"));
+
+            std::shared_ptr<nbt::tag_compound> nbtData;
+            if (be.has_key("Data", nbt::tag_type::Compound)) {
+                nbtData = std::make_shared<nbt::tag_compound>(std::move(be.at("Data").as<nbt::tag_compound>()));
+            }
+            else {
+                nbtData = std::make_shared<nbt::tag_compound>(std::move(be));
+                nbtData->erase("Pos");
+                nbtData->erase("Id");
             }
+            if (!id.empty()) nbtData->put("id", nbt::tag_string(id));
+            map[blockPositionKey(x, y, z)] = std::move(nbtData);
+        }
+    }
 
-            // 解码变长整数    
-            std::vector<int> blockIndices = decodeVarIntArray(blockData, width * height * length);
+    // Palette (名称 -> 索引) 反转为按索引排列的名称表与翻译表;
+    // 空气和文件中未出现的索引标记为 AIR_ENTRY, 其余在首次出现时才翻译并注册
+    static void buildPaletteTable(const nbt::tag_compound& palette,
+        std::vector<std::string>& names, std::vector<PaletteID>& table) {
+        int maxPaletteId = -1;
+        for (const auto& [blockName, idTag] : palette) {
+            maxPaletteId = std::max(maxPaletteId, static_cast<int>(static_cast<int32_t>(idTag)));
+        }
+        names.assign(static_cast<size_t>(maxPaletteId + 1), std::string());
+        table.assign(static_cast<size_t>(maxPaletteId + 1), AIR_ENTRY);
+        for (const auto& [blockName, idTag] : palette) {
+            int paletteId = static_cast<int32_t>(idTag);
+            if (paletteId < 0) continue;
+            names[paletteId] = blockName;
+            if (blockName.find("air") == std::string::npos)
+                table[paletteId] = UNRESOLVED_ENTRY;
+        }
+    }
 
-            // 遍历所有方块 (YZX 顺序)    
-            for (int y = 0; y < height; ++y) {
-                for (int z = 0; z < length; ++z) {
-                    for (int x = 0; x < width; ++x) {
-                        int index = x + (z * width) + (y * width * length);
-                        int paletteId = blockIndices[index];
+    // 边解码边写入: readBytes(buf, n) 提供方块数据的下一段字节
+    // 索引顺序 index = x + z * width + y * width * length, 每次解码一行 (固定 y, z);
+    // 写入坐标加上 Offset (applyOffset 时), 方块实体仍按局部坐标查找
+    template<typename ReadBytes>
+    void emitBlocks(SchematicState& state, BCFCachedWriter& writer, int32_t byteCount, ReadBytes&& readBytes) {
+        const int offsetX = m_applyOffset ? state.offsetX : 0;
+        const int offsetY = m_applyOffset ? state.offsetY : 0;
+        const int offsetZ = m_applyOffset ? state.offsetZ : 0;
+        checkBounds(state, writer, offsetX, offsetY, offsetZ);
+
+        VarIntArrayDecoder decoder;
+        constexpr size_t CHUNK_BYTES = 64 * 1024;
+        std::vector<int8_t> chunk(std::min<size_t>(CHUNK_BYTES, static_cast<size_t>(byteCount)));
+        size_t remainingBytes = static_cast<size_t>(byteCount);
+        auto feedNext = [&]() {
+            size_t n = std::min(remainingBytes, chunk.size());
+            readBytes(chunk.data(), n);
+            decoder.feed(chunk.data(), n);
+            remainingBytes -= n;
+        };
+
+        const int width = state.width, height = state.height, length = state.length;
+        std::vector<PaletteID>& paletteTable = state.paletteTable;
+        const BlockEntityMap& blockEntities = state.blockEntities;
+        const size_t tableSize = paletteTable.size();
+
+        std::vector<uint32_t> row(static_cast<size_t>(width));
+        bool truncated = false;
+        for (int y = 0; y < height && !truncated; ++y) {
+            for (int z = 0; z < length; ++z) {
+                size_t got = decoder.decode(row.data(), row.size());
+                while (got < row.size() && remainingBytes > 0) {
+                    feedNext();
+                    got += decoder.decode(row.data() + got, row.size() - got);
+                }
 
-                        // 过滤空气方块    
-                        if (paletteId < 0 || paletteId >= (int)paletteMap.size()
-                            || isAirPalette[paletteId]) {
+                for (size_t i = 0; i < got; ++i) {
+                    uint32_t paletteIndex = row[i];
+                    if (paletteIndex >= tableSize) continue;
+                    PaletteID& id = paletteTable[paletteIndex];
+                    if (id == AIR_ENTRY) continue;
+                    int x = static_cast<int>(i);
+
+                    // 带方块实体的方块单独注册 (类型+状态+NBT), 其余按翻译表写入
+                    if (!blockEntities.empty()) {
+                        auto it = blockEntities.find(blockPositionKey(x, y, z));
+                        if (it != blockEntities.end()) {
+                            writer.addBlock(offsetX + x, offsetY + y, offsetZ + z,
+                                translatePaletteEntry(state.paletteNames[paletteIndex], writer, it->second));
                             continue;
                         }
-
-                        // 解析方块名称和状态    
-                        auto [blockFullName, _] = paletteMap[paletteId];
-                        auto [blockName, states] = parseBlockNameAndStates(blockFullName);
-
-                        // 应用 Java 到 Bedrock 转换  
-                        auto [beBlockName, beStates] = m_converter.convert(blockName, states);
-
-                        // 添加方块    
-                        writer.addBlock(x, y, z, beBlockName, beStates);
                     }
+                    if (id == UNRESOLVED_ENTRY)
+                        id = translatePaletteEntry(state.paletteNames[paletteIndex], writer);
+                    writer.addBlock(offsetX + x, offsetY + y, offsetZ + z, id);
                 }
-            }
 
-            std::cout << "转换完成!" << std::endl;
-            writer.finalize();
-            std::cout << "写入文件完成!" << std::endl;
+                // 方块数据不足: 剩余方块按空气处理
+                if (got < row.size()) {
+                    Log::warn() << "警告: BlockData 数据不足, 剩余方块已忽略";
+                    truncated = true;
+                    break;
+                }
+            }
         }
-        catch (const std::exception& e) {
-            std::cerr << "转换错误: " << e.what() << std::endl;
-            return;
+
+        // 多出的字节也要从流中读掉
+        while (remainingBytes > 0) {
+            size_t n = std::min(remainingBytes, chunk.size());
+            readBytes(chunk.data(), n);
+            remainingBytes -= n;
         }
     }
 
-private:
-    // 解码变长整数数组    
-    std::vector<int> decodeVarIntArray(const nbt::tag_byte_array& data, int totalBlocks) {
-        std::vector<int> result;
-        result.reserve(totalBlocks);
-
-        size_t byteIndex = 0;
-        while (result.size() < (size_t)totalBlocks && byteIndex < data.size()) {
-            int value = 0;
-            int shift = 0;
-            uint8_t byte;
-
-            // 读取变长整数    
-            do {
-                if (byteIndex >= data.size()) break;
-                byte = static_cast<uint8_t>(data[byteIndex++]);
-                value |= (byte & 0x7F) << shift;
-                shift += 7;
-            } while (byte & 0x80);
-
-            result.push_back(value);
+    // 平移后的包围盒必须在 writer 可表示的坐标范围内, 否则方块会落到错误的子区块或 Y 溢出
+    static void checkBounds(const SchematicState& state, const BCFCachedWriter& writer,
+        int offsetX, int offsetY, int offsetZ) {
+        if (state.width == 0 || state.height == 0 || state.length == 0) return;
+        auto inRange = [](int64_t lo, int64_t size, int64_t minV, int64_t maxV) {
+            return lo >= minV && lo + size - 1 <= maxV;
+        };
+        if (!inRange(offsetX, state.width, BCFCachedWriter::MIN_XZ, BCFCachedWriter::MAX_XZ)
+            || !inRange(offsetZ, state.length, BCFCachedWriter::MIN_XZ, BCFCachedWriter::MAX_XZ)
+            || !inRange(offsetY, state.height, writer.minWorldY(), writer.maxWorldY())) {
+            throw std::runtime_error("Schematic 超出 BCF 坐标范围: 偏移 (" + std::to_string(offsetX) + ", "
+                + std::to_string(offsetY) + ", " + std::to_string(offsetZ) + "), 尺寸 "
+                + std::to_string(state.width) + "x" + std::to_string(state.height) + "x" + std::to_string(state.length));
         }
+    }
 
-        return result;
+    // 每个 palette 条目只翻译一次 (带方块实体的方块除外): 解析名称和状态, 经转换表转为基岩版后注册
+    PaletteID translatePaletteEntry(const std::string& blockFullName, BCFCachedWriter& writer,
+        std::shared_ptr<nbt::tag_compound> nbtData = nullptr) {
+        auto [blockName, states] = parseBlockNameAndStates(blockFullName);
+        auto [beBlockName, beStates] = m_converter.convert(blockName, states);
+        return writer.registerPalette(beBlockName, beStates, std::move(nbtData));
     }
 
     // 解析方块名称和状态    
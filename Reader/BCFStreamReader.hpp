@@ -2,20 +2,57 @@
 #include <fstream>    
 #include <vector>    
 #include <unordered_map>  
+#include <unordered_set>
+#include <string_view>
+#include <iostream>
 #include "core/bcf_structs.hpp"    
 #include "core/bcf_io.hpp"    
 #include "core/SubChunkUtils.hpp"    
+#include "core/SubChunkDirectory.hpp"
+#include "core/ByteCursor.hpp"
+#include "core/Checksum.hpp"
+#include "core/Log.hpp"
+
+// 解码后的 palette 条目: 类型名和状态在首次访问该条目时解析好,
+// 之后逐区域访问时只返回引用, 不再查表或分配字符串
+struct DecodedPaletteEntry {
+    std::string typeName;
+    std::vector<std::pair<std::string, std::string>> states;  // <状态名, 状态值>, 与 BCFCachedWriter::addBlock 参数一致
+};
     
 class BCFStreamReader {    
 private:    
     std::string filename;    
     BCFHeader header;    
     std::vector<FilePos> subChunkOffsets;    
-    std::vector<PaletteKey> paletteList;    
+    // palette 条目: v7 起打开时只读定长索引, 记录在首次访问该 PaletteID 时解码
+    mutable std::vector<PaletteKey> paletteList;    
+    std::vector<PaletteIndexEntry> paletteIndex;  // v7: palette 记录与 NBT 的位置, NBT 按需读取
+    std::vector<char> paletteRecords;             // v7: 索引之后的全部变长记录
+    FilePos paletteRecordBase = 0;                // paletteRecords[0] 在文件中的偏移
+    enum PaletteLoadState : uint8_t { PALETTE_UNLOADED, PALETTE_RECORD, PALETTE_DECODED };
+    mutable std::vector<uint8_t> paletteLoaded;   // 每个 PaletteID 的解码进度
+    mutable std::unordered_map<PaletteID, std::shared_ptr<nbt::tag_compound>> nbtCache;  // v7: 已解析的 NBT
+
+    // 子区块目录: 新文件直接从尾部读取, 旧文件首次访问时扫描子区块头生成
+    std::vector<SubChunkDirEntry> directory;
+    std::vector<std::vector<PaletteID>> subChunkPaletteIds;  // 每个子区块使用的 paletteId (升序)
+    bool hasStoredDirectory = false;
+    std::vector<uint32_t> subChunkChecksums;  // v8: 每个子区块的 CRC32, 读取时校验
+    std::vector<OccupancyMap> subChunkOccupancy;  // 每个子区块的 16³ 占用位图
+    BCFFooter footer;                         // v8: 文件尾
+    FilePos metadataEnd = 0;                  // 元数据结束位置 (v8 为文件尾起点, 之前为文件长度)
       
     std::unordered_map<BlockTypeID, std::string> typeMap;    
     std::unordered_map<BlockStateID, std::string> stateMap;    
     std::unordered_map<StateValueID, std::string> stateValueMap;
+
+    // 按 PaletteID 索引的解码 palette (首次访问时填充)
+    mutable std::vector<DecodedPaletteEntry> decodedPalette;
+
+    // getBlockNBTData(x, y, z, ...) 最近一次访问的子区块中带 NBT 的区域
+    mutable size_t nbtRegionsSubChunk = SIZE_MAX;
+    mutable std::vector<BlockRegion> nbtRegions;
       
     // 优化 1: 缓存文件流,避免重复打开  
     mutable std::ifstream cachedStream;  
@@ -31,85 +68,125 @@ public:
     if (header.version < 2) {  
         throw std::runtime_error("File version does not support streaming (version < 2)");  
     }  
+    if (header.version > 8) {
+        throw std::runtime_error("Unsupported BCF version: " + std::to_string(header.version));
+    }
   
 
-    ifs.seekg(header.subChunkOffsetsTableOffset, std::ios::beg);  
-    FilePos subChunkCount = read_u64(ifs);  
-    subChunkOffsets.reserve(subChunkCount);  
-    for (FilePos i = 0; i < subChunkCount; i++) {  
-        subChunkOffsets.push_back(read_u64(ifs));  
-    }  
-  
+    ifs.seekg(0, std::ios::end);
+    FilePos fileSize = static_cast<FilePos>(ifs.tellg());
+    metadataEnd = fileSize;
+
+    // v8 文件必须以完整的文件尾结束, 否则说明写入中断
+    if (header.version >= 8) {
+        if (fileSize < sizeof(BCFHeader) + sizeof(BCFFooter)) {
+            throw std::runtime_error("BCF file is truncated: missing footer");
+        }
+        ifs.seekg(fileSize - sizeof(BCFFooter), std::ios::beg);
+        read_le<BCFFooter>(ifs, footer);
+        if (!ifs || !footer.hasValidMagic() || footer.fileSize != fileSize) {
+            throw std::runtime_error("BCF file is truncated: missing footer");
+        }
+        metadataEnd = fileSize - sizeof(BCFFooter);
+    }
+
+    // 偏移量表和子区块目录一次读入内存 (v7 到 NBT 堆为止, 之前到 palette 为止)
+    FilePos tableEnd = header.version >= 7 ? header.nbtDataOffset : header.paletteOffset;
+    if (header.subChunkOffsetsTableOffset > tableEnd || tableEnd > metadataEnd
+        || header.paletteOffset > metadataEnd) {
+        throw std::runtime_error("Corrupt BCF section offsets");
+    }
+    std::vector<char> tableData = readFileRange(ifs, header.subChunkOffsetsTableOffset,
+        static_cast<size_t>(tableEnd - header.subChunkOffsetsTableOffset));
+    ByteCursor table(tableData);
 
-    ifs.seekg(header.paletteOffset, std::ios::beg);
-    uint32_t paletteCount = read_u32(ifs);
-    paletteList.reserve(paletteCount);
-    for (uint32_t i = 0; i < paletteCount; i++) {
-        FilePos beforeEntry = ifs.tellg();
-
-        uint32_t pid = read_u32(ifs);
-        BlockTypeID typeId = read_u16(ifs);
-        uint16_t stateCount = read_u16(ifs);
-
-        PaletteKey pk;
-        pk.typeId = typeId;
-        for (uint16_t j = 0; j < stateCount; j++) {
-            BlockStateID sid = read_u8(ifs);
-            BlockStateID val = read_u8(ifs);
-            pk.states.push_back({ sid, val });
+    FilePos subChunkCount = table.u64();
+    if (subChunkCount > table.remaining() / sizeof(FilePos)) {
+        throw std::runtime_error("Corrupt sub-chunk offset table");
+    }
+    subChunkOffsets.resize(subChunkCount);
+    table.bytes(subChunkOffsets.data(), subChunkCount * sizeof(FilePos));
+
+    // 读取子区块目录 (位于偏移量表与 palette 之间, 旧文件没有)
+    hasStoredDirectory = SubChunkDirectory::tryRead(table, subChunkCount,
+        directory, subChunkPaletteIds, subChunkChecksums, subChunkOccupancy);
+    if (!hasStoredDirectory) {
+        directory.clear();
+        subChunkPaletteIds.clear();
+        subChunkChecksums.clear();
+        subChunkOccupancy.clear();
+    }
+
+    // palette 和三张名称表位于文件末尾, 同样整块读入
+    std::vector<char> metaData = readFileRange(ifs, header.paletteOffset,
+        static_cast<size_t>(metadataEnd - header.paletteOffset));
+    ByteCursor meta(metaData);
+    auto seekMeta = [&](FilePos offset) {
+        if (offset < header.paletteOffset) {
+            throw std::runtime_error("Corrupt BCF section offsets");
         }
+        meta.seek(static_cast<size_t>(offset - header.paletteOffset));
+    };
 
+    uint32_t paletteCount = meta.u32();
+    if (header.version >= 7) {
+        // 只读入定长索引; 记录紧跟在索引之后, 连同索引一起校验后留在内存中按需解码
+        if (paletteCount > meta.remaining() / sizeof(PaletteIndexEntry)) {
+            throw std::runtime_error("Failed to read palette");
+        }
+        paletteIndex.resize(paletteCount);
+        meta.bytes(paletteIndex.data(), paletteCount * sizeof(PaletteIndexEntry));
 
-        if (header.version >= 4) {
-            std::string nbtStr = readString32(ifs);
-            if (!nbtStr.empty()) {
-                std::istringstream iss(nbtStr);
-                try {
-                    nbt::io::stream_reader reader(iss, endian::little);
-                    auto root = reader.read_tag();  // 使用 read_tag 读取完整格式  
-
-                    if (root.second && root.second->get_type() == nbt::tag_type::Compound) {
-                        pk.nbtData = std::shared_ptr<nbt::tag_compound>(
-                            static_cast<nbt::tag_compound*>(root.second.release())
-                        );
-                    }
-                    else {
-                        pk.nbtData = nullptr;
-                    }
-                }
-                catch (const std::exception& e) {
-                    pk.nbtData = nullptr;
-                }
+        paletteRecordBase = header.paletteOffset + meta.position();
+        if (header.blockTypeMapOffset < paletteRecordBase || header.blockTypeMapOffset > metadataEnd) {
+            throw std::runtime_error("Corrupt BCF section offsets");
+        }
+        paletteRecords.assign(metaData.begin() + meta.position(),
+            metaData.begin() + static_cast<size_t>(header.blockTypeMapOffset - header.paletteOffset));
+        for (const auto& entry : paletteIndex) {
+            if (entry.recordOffset < paletteRecordBase
+                || entry.recordOffset - paletteRecordBase >= paletteRecords.size()) {
+                throw std::runtime_error("Corrupt palette index");
             }
         }
-        paletteList.push_back(pk);  
-    }  
+        paletteList.resize(paletteCount);
+        paletteLoaded.assign(paletteCount, PALETTE_UNLOADED);
+    }
+    else {
+        paletteList.reserve(paletteCount);
+        for (uint32_t i = 0; i < paletteCount; i++) {
+            PaletteKey pk = readPaletteRecord(meta, i);
+            if (header.version >= 4) {
+                pk.nbtData = parseNBT(meta.string32());
+            }
+            paletteList.push_back(std::move(pk));
+        }
+        paletteLoaded.assign(paletteCount, PALETTE_RECORD);
+    }
+    decodedPalette.resize(paletteCount);
   
     // 读取类型名映射  
-    ifs.seekg(header.blockTypeMapOffset, std::ios::beg);  
-    uint32_t typeCount = read_u32(ifs);  
+    seekMeta(header.blockTypeMapOffset);
+    uint32_t typeCount = meta.u32();
     for (uint32_t i = 0; i < typeCount; i++) {  
-        BlockTypeID typeId = read_u16(ifs);  
-        std::string typeName = readString16(ifs);  
-        typeMap[typeId] = typeName;  
+        BlockTypeID typeId = meta.u16();
+        typeMap[typeId] = meta.string16();
     }  
   
     // 读取状态名映射  
-    ifs.seekg(header.stateNameMapOffset, std::ios::beg);  
-    uint32_t stateCount = read_u32(ifs);  
+    seekMeta(header.stateNameMapOffset);
+    uint32_t stateCount = meta.u32();
     for (uint32_t i = 0; i < stateCount; i++) {  
-        BlockStateID stateId = read_u8(ifs);  
-        std::string stateName = readString16(ifs);  
-        stateMap[stateId] = stateName;  
+        BlockStateID stateId = readStateId(meta);
+        stateMap[stateId] = meta.string16();
     }  
   
     // 读取状态值映射  
-    ifs.seekg(header.stateValueMapOffset, std::ios::beg);  
-    uint32_t valueCount = read_u32(ifs);  
+    seekMeta(header.stateValueMapOffset);
+    uint32_t valueCount = meta.u32();
     for (uint32_t i = 0; i < valueCount; i++) {  
-        StateValueID valueId = read_u8(ifs);  
-        std::string valueName = readString16(ifs);  
-        stateValueMap[valueId] = valueName;  
+        StateValueID valueId = readStateValueId(meta);
+        stateValueMap[valueId] = meta.string16();
     }  
 }
 
@@ -168,26 +245,9 @@ public:
     //}    
     
     size_t getSubChunkCount() const { return subChunkOffsets.size(); }    
-    // 在 BCFStreamReader 中添加:  
-std::vector<BlockRegion> getBlockRegions(size_t subChunkIndex) {  
-    std::vector<BlockRegion> result;  
-    if (subChunkIndex >= subChunkOffsets.size()) return result;  
-  
-    if (!cachedStream.is_open()) {  
-        cachedStream.open(filename, std::ios::binary);  
-        if (!cachedStream) {  
-            throw std::runtime_error("Failed to reopen file for streaming");  
-        }  
-    }  
-  
-    cachedStream.seekg(subChunkOffsets[subChunkIndex], std::ios::beg);  
-    SubChunkSize sz;  
-    Coord ox, oy, oz;  
-    return SubChunkUtils::readSubChunk(cachedStream, sz, ox, oy, oz);  
-}
+    // 读取指定子区块的全部区域 (使用内部缓存的文件流)
 std::vector<BlockRegion> getBlockRegions(size_t subChunkIndex) const {
-    std::vector<BlockRegion> result;
-    if (subChunkIndex >= subChunkOffsets.size()) return result;
+    if (subChunkIndex >= subChunkOffsets.size()) return {};
 
     if (!cachedStream.is_open()) {
         cachedStream.open(filename, std::ios::binary);
@@ -196,20 +256,52 @@ std::vector<BlockRegion> getBlockRegions(size_t subChunkIndex) const {
         }
     }
 
-    cachedStream.seekg(subChunkOffsets[subChunkIndex], std::ios::beg);
+    SubChunkOrigin origin;
+    return readBlockRegions(cachedStream, subChunkIndex, origin);
+}
+
+// 使用调用方提供的文件流读取子区块, 同时返回起始坐标
+// 不访问 cachedStream, 可在后台预取线程中与主线程并行调用
+std::vector<BlockRegion> readBlockRegions(std::ifstream& ifs, size_t subChunkIndex,
+    SubChunkOrigin& origin) const {
+    if (subChunkIndex >= subChunkOffsets.size()) {
+        throw std::out_of_range("Invalid subChunkIndex");
+    }
+
+    ifs.seekg(subChunkOffsets[subChunkIndex], std::ios::beg);
     SubChunkSize sz;
-    Coord ox, oy, oz;
-    return SubChunkUtils::readSubChunk(cachedStream, sz, ox, oy, oz);
+    auto regions = SubChunkUtils::readSubChunk(ifs, header.version, sz, origin.originX, origin.originY, origin.originZ,
+        expectedChecksum(subChunkIndex));
+    if (!ifs) {
+        throw std::runtime_error("Failed to read sub-chunk " + std::to_string(subChunkIndex));
+    }
+    return regions;
 }
 
+const std::string& getFilename() const { return filename; }
+Version getVersion() const { return header.version; }
+
+    // v7 文件的 nbtData 不在这里填充, 请使用 getBlockNBTData
     const PaletteKey& getPaletteKey(PaletteID paletteId) const {
         if (paletteId >= paletteList.size()) {
             throw std::out_of_range("Invalid paletteId");
         }
-        return paletteList[paletteId];
+        return loadPaletteRecord(paletteId);
     }
 
     std::string getBlockType(BlockTypeID typeId) const {
+        return std::string(getBlockTypeView(typeId));
+    }
+
+    std::string getStateName(BlockStateID stateId) const {
+        return std::string(getStateNameView(stateId));
+    }
+    std::string getStateValue(StateValueID valueId) const {
+        return std::string(getStateValueView(valueId));
+    }
+
+    // string_view 版本: 指向 reader 内部的字符串, 不分配内存
+    std::string_view getBlockTypeView(BlockTypeID typeId) const {
         auto it = typeMap.find(typeId);
         if (it == typeMap.end()) {
             return "minecraft:air";
@@ -217,30 +309,86 @@ std::vector<BlockRegion> getBlockRegions(size_t subChunkIndex) const {
         return it->second;
     }
 
-    std::string getStateName(BlockStateID stateId) const {
+    std::string_view getStateNameView(BlockStateID stateId) const {
         auto it = stateMap.find(stateId);
         if (it == stateMap.end()) {
             return "unknown";
         }
         return it->second;
     }
-    std::string getStateValue(StateValueID valueId) const {
+
+    std::string_view getStateValueView(StateValueID valueId) const {
         auto it = stateValueMap.find(valueId);
         if (it == stateValueMap.end()) {
             return "0";  // 默认值  
         }
         return it->second;
     }
+
+    // 按 PaletteID 获取解码后的类型名和状态 (每个条目只在首次访问时解码, 之后零分配)
+    const DecodedPaletteEntry& getDecodedPalette(PaletteID paletteId) const {
+        if (paletteId >= decodedPalette.size()) {
+            throw std::out_of_range("Invalid paletteId");
+        }
+        if (paletteLoaded[paletteId] != PALETTE_DECODED) {
+            decodePaletteEntry(paletteId);
+        }
+        return decodedPalette[paletteId];
+    }
+
+    std::string_view getTypeName(PaletteID paletteId) const {
+        return getDecodedPalette(paletteId).typeName;
+    }
+
+    size_t getPaletteCount() const { return paletteList.size(); }
 // 获取指定PaletteID的NBT数据  
+// v7 文件首次调用时从 NBT 堆读取并解析, 之后返回缓存的同一对象
 std::shared_ptr<nbt::tag_compound> getBlockNBTData(PaletteID paletteId) const {
     if (paletteId >= paletteList.size()) return nullptr;  
-    return paletteList[paletteId].nbtData;  
+    if (header.version < 7) return paletteList[paletteId].nbtData;
+
+    const PaletteIndexEntry& entry = paletteIndex[paletteId];
+    if (entry.nbtSize == 0) return nullptr;
+    auto cached = nbtCache.find(paletteId);
+    if (cached != nbtCache.end()) return cached->second;
+
+    if (!cachedStream.is_open()) {
+        cachedStream.open(filename, std::ios::binary);
+        if (!cachedStream) {
+            throw std::runtime_error("Failed to reopen file for streaming");
+        }
+    }
+    std::string nbtStr(entry.nbtSize, '\0');
+    cachedStream.seekg(entry.nbtOffset, std::ios::beg);
+    cachedStream.read(&nbtStr[0], nbtStr.size());
+    if (!cachedStream) {
+        throw std::runtime_error("Failed to read NBT for paletteId " + std::to_string(paletteId));
+    }
+    auto nbtData = parseNBT(nbtStr);
+    nbtCache.emplace(paletteId, nbtData);
+    return nbtData;
 }  
+
+// palette 记录和 NBT 在文件中的位置 (仅 v7), 可用于 mmap NBT 堆后直接访问
+const PaletteIndexEntry& getPaletteIndexEntry(PaletteID paletteId) const {
+    if (paletteId >= paletteIndex.size()) {
+        throw std::out_of_range("Invalid paletteId");
+    }
+    return paletteIndex[paletteId];
+}
+bool hasPaletteIndex() const { return !paletteIndex.empty(); }
   
 // 获取指定方块的完整NBT数据  
+// 只保留最近访问的子区块中带 NBT 的区域, 同一子区块内连续查询不再重复读取
 std::shared_ptr<nbt::tag_compound> getBlockNBTData(int x, int y, int z, size_t subChunkIndex) const {
-    auto regions = getBlockRegions(subChunkIndex);  
-    for (const auto& region : regions) {  
+    if (subChunkIndex != nbtRegionsSubChunk) {
+        nbtRegions.clear();
+        for (const auto& region : getBlockRegions(subChunkIndex)) {
+            if (hasBlockNBTData(region.paletteId)) nbtRegions.push_back(region);
+        }
+        nbtRegionsSubChunk = subChunkIndex;
+    }
+    for (const auto& region : nbtRegions) {  
         if (x >= region.x1 && x <= region.x2 &&  
             y >= region.y1 && y <= region.y2 &&  
             z >= region.z1 && z <= region.z2) {  
@@ -250,6 +398,13 @@ std::shared_ptr<nbt::tag_compound> getBlockNBTData(int x, int y, int z, size_t s
     return nullptr;  
 }
 
+// palette 条目是否带 NBT (不读取 NBT 本身)
+bool hasBlockNBTData(PaletteID paletteId) const {
+    if (paletteId >= paletteList.size()) return false;
+    if (header.version < 7) return paletteList[paletteId].nbtData != nullptr;
+    return paletteIndex[paletteId].nbtSize != 0;
+}
+
 // 获取指定 subchunk 的起始坐标  
 
   
@@ -261,6 +416,15 @@ SubChunkOrigin getSubChunkOrigin(size_t subChunkIndex) {
         origin.originZ = 0;  
         return origin;  
     }  
+
+    // 有目录时无需访问子区块数据
+    if (hasStoredDirectory) {
+        const auto& e = directory[subChunkIndex];
+        origin.originX = e.originX;
+        origin.originY = e.originY;
+        origin.originZ = e.originZ;
+        return origin;
+    }
   
     if (!cachedStream.is_open()) {  
         cachedStream.open(filename, std::ios::binary);  
@@ -282,6 +446,307 @@ SubChunkOrigin getSubChunkOrigin(size_t subChunkIndex) {
       
     return origin;  
 }
+// 文件尾部是否带有子区块目录
+bool hasSubChunkDirectory() const { return hasStoredDirectory; }
+
+// 获取子区块目录; 旧文件会在首次调用时读取全部子区块生成
+const std::vector<SubChunkDirEntry>& getSubChunkDirectory() {
+    if (directory.size() == subChunkOffsets.size()) return directory;
+    rebuildDirectory();
+    return directory;
+}
+
+const SubChunkDirEntry& getSubChunkInfo(size_t subChunkIndex) {
+    const auto& dir = getSubChunkDirectory();
+    if (subChunkIndex >= dir.size()) {
+        throw std::out_of_range("Invalid subChunkIndex");
+    }
+    return dir[subChunkIndex];
+}
+
+// 子区块使用的 paletteId 列表 (升序); 目录中没有时扫描一次全部子区块生成
+const std::vector<PaletteID>& getSubChunkPaletteIds(size_t subChunkIndex) {
+    if (subChunkIndex >= subChunkOffsets.size()) {
+        throw std::out_of_range("Invalid subChunkIndex");
+    }
+    if (subChunkPaletteIds.size() != subChunkOffsets.size()) {
+        rebuildDirectory();
+    }
+    return subChunkPaletteIds[subChunkIndex];
+}
+
+// 子区块的 16³ 占用位图; 目录中没有时扫描一次全部子区块生成
+const OccupancyMap& getSubChunkOccupancy(size_t subChunkIndex) {
+    if (subChunkIndex >= subChunkOffsets.size()) {
+        throw std::out_of_range("Invalid subChunkIndex");
+    }
+    if (subChunkOccupancy.size() != subChunkOffsets.size()) {
+        rebuildDirectory();
+    }
+    return subChunkOccupancy[subChunkIndex];
+}
+
+// 构建包含指定方块类型 (如 "minecraft:chest") 的所有 paletteId 的过滤器
+PaletteFilter makePaletteFilter(const std::vector<std::string>& blockTypes) const {
+    PaletteFilter filter(paletteList.size());
+    std::unordered_set<std::string> names(blockTypes.begin(), blockTypes.end());
+    std::unordered_set<BlockTypeID> wanted;
+    for (const auto& [typeId, typeName] : typeMap) {
+        if (names.count(typeName)) wanted.insert(typeId);
+    }
+    for (size_t pid = 0; pid < paletteList.size(); pid++) {
+        if (wanted.count(loadPaletteRecord(static_cast<PaletteID>(pid)).typeId)) {
+            filter.set(static_cast<PaletteID>(pid));
+        }
+    }
+    return filter;
+}
+
+PaletteFilter makePaletteFilter(const std::vector<PaletteID>& paletteIds) const {
+    PaletteFilter filter(paletteList.size());
+    for (PaletteID id : paletteIds) filter.set(id);
+    return filter;
+}
+
+// 返回至少包含一个命中 paletteId 的子区块索引, 仅依据目录判断, 不读取子区块内容
+std::vector<size_t> findSubChunksWithPalettes(const PaletteFilter& filter) {
+    std::vector<size_t> result;
+    if (filter.empty()) return result;
+
+    if (subChunkPaletteIds.size() != subChunkOffsets.size()) {
+        rebuildDirectory();
+    }
+    for (size_t i = 0; i < subChunkPaletteIds.size(); i++) {
+        if (filter.matchesAny(subChunkPaletteIds[i])) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+// 只解码命中过滤器的区域; 子区块不含任何命中 paletteId 时不会访问文件
+std::vector<BlockRegion> getBlockRegions(size_t subChunkIndex, const PaletteFilter& filter) {
+    if (!filter.matchesAny(getSubChunkPaletteIds(subChunkIndex))) return {};
+
+    if (!cachedStream.is_open()) {
+        cachedStream.open(filename, std::ios::binary);
+        if (!cachedStream) {
+            throw std::runtime_error("Failed to reopen file for streaming");
+        }
+    }
+    cachedStream.seekg(subChunkOffsets[subChunkIndex], std::ios::beg);
+    SubChunkSize sz;
+    Coord ox, oy, oz;
+    return SubChunkUtils::readSubChunkFiltered(cachedStream, header.version, sz, ox, oy, oz, filter,
+        expectedChecksum(subChunkIndex));
+}
+
+// 完整校验文件: 文件头、元数据 (偏移量表到文件尾) 和每个子区块的 CRC32
+// 任何一项不符或文件没有校验和 (v8 之前) 时返回 false, 原因通过 Log::error 输出
+bool verify() const {
+    if (header.version < 8 || subChunkChecksums.size() != subChunkOffsets.size()) {
+        Log::error() << "verify: " << filename << " has no checksums (version " << int(header.version) << ")";
+        return false;
+    }
+
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        Log::error() << "verify: failed to open " << filename;
+        return false;
+    }
+
+    if (Checksum::compute(&header, sizeof(header)) != footer.headerCrc) {
+        Log::error() << "verify: header checksum mismatch";
+        return false;
+    }
+
+    uint32_t metadataCrc = 0;
+    if (!checksumRange(ifs, header.subChunkOffsetsTableOffset, metadataEnd, metadataCrc)
+        || metadataCrc != footer.metadataCrc) {
+        Log::error() << "verify: metadata checksum mismatch";
+        return false;
+    }
+
+    for (size_t i = 0; i < directory.size(); i++) {
+        uint32_t crc = 0;
+        const SubChunkDirEntry& e = directory[i];
+        if (!checksumRange(ifs, e.offset, e.offset + e.subChunkSize, crc) || crc != subChunkChecksums[i]) {
+            Log::error() << "verify: sub-chunk " << i << " checksum mismatch";
+            return false;
+        }
+    }
+    return true;
+}
+
+private:
+const uint32_t* expectedChecksum(size_t subChunkIndex) const {
+    return subChunkIndex < subChunkChecksums.size() ? &subChunkChecksums[subChunkIndex] : nullptr;
+}
+
+// 分块计算 [begin, end) 的 CRC32
+static bool checksumRange(std::ifstream& ifs, FilePos begin, FilePos end, uint32_t& crc) {
+    crc = 0;
+    if (end < begin) return false;
+    std::vector<char> buffer(1 << 20);
+    ifs.clear();
+    ifs.seekg(begin, std::ios::beg);
+    for (FilePos remaining = end - begin; remaining > 0; ) {
+        size_t n = static_cast<size_t>(std::min<FilePos>(remaining, buffer.size()));
+        ifs.read(buffer.data(), n);
+        if (!ifs) return false;
+        crc = Checksum::update(crc, buffer.data(), n);
+        remaining -= n;
+    }
+    return true;
+}
+
+// v6 起状态名/状态值 ID 为 varint, 之前为 u8
+BlockStateID readStateId(ByteCursor& in) const {
+    return header.version >= 6 ? static_cast<BlockStateID>(in.varint()) : in.u8();
+}
+StateValueID readStateValueId(ByteCursor& in) const {
+    return header.version >= 6 ? static_cast<StateValueID>(in.varint()) : in.u8();
+}
+
+// 解析一段小端序 NBT, 不是 Compound 或解析失败时返回空
+static std::shared_ptr<nbt::tag_compound> parseNBT(const std::string& nbtStr) {
+    if (nbtStr.empty()) return nullptr;
+    std::istringstream iss(nbtStr);
+    try {
+        nbt::io::stream_reader reader(iss, endian::little);
+        auto root = reader.read_tag();  // 使用 read_tag 读取完整格式  
+        if (root.second && root.second->get_type() == nbt::tag_type::Compound) {
+            return std::shared_ptr<nbt::tag_compound>(
+                static_cast<nbt::tag_compound*>(root.second.release()));
+        }
+    }
+    catch (const std::exception&) {
+    }
+    return nullptr;
+}
+
+// 解码一条 palette 记录: pid | typeId | stateCount | stateCount 对 (状态名, 状态值)
+// 存储的 pid 必须与其位置一致
+PaletteKey readPaletteRecord(ByteCursor& in, uint32_t expectedPid) const {
+    in.require(sizeof(uint32_t) + sizeof(BlockTypeID) + sizeof(uint16_t));
+    uint32_t pid = in.getUnchecked<uint32_t>();
+    if (pid != expectedPid) {
+        throw std::runtime_error("Corrupt palette record " + std::to_string(expectedPid));
+    }
+    PaletteKey pk;
+    pk.typeId = in.getUnchecked<BlockTypeID>();
+    uint16_t stateCount = in.getUnchecked<uint16_t>();
+    pk.states.reserve(stateCount);
+    for (uint16_t j = 0; j < stateCount; j++) {
+        BlockStateID sid = readStateId(in);
+        StateValueID val = readStateValueId(in);
+        pk.states.push_back({ sid, val });
+    }
+    return pk;
+}
+
+// v7: 按索引中的 recordOffset 解码 palette 记录, 每个 PaletteID 只解码一次
+const PaletteKey& loadPaletteRecord(PaletteID pid) const {
+    if (paletteLoaded[pid] == PALETTE_UNLOADED) {
+        ByteCursor in(paletteRecords);
+        in.seek(static_cast<size_t>(paletteIndex[pid].recordOffset - paletteRecordBase));
+        paletteList[pid] = readPaletteRecord(in, pid);
+        paletteLoaded[pid] = PALETTE_RECORD;
+    }
+    return paletteList[pid];
+}
+
+// 把 palette 条目的类型名和状态解析成字符串, 之后按 PaletteID 直接索引
+void decodePaletteEntry(PaletteID pid) const {
+    const PaletteKey& pk = loadPaletteRecord(pid);
+    DecodedPaletteEntry& entry = decodedPalette[pid];
+    entry.typeName = std::string(getBlockTypeView(pk.typeId));
+    entry.states.clear();
+    entry.states.reserve(pk.states.size());
+    for (const auto& s : pk.states) {
+        entry.states.emplace_back(std::string(getStateNameView(s.first)),
+            std::string(getStateValueView(s.second)));
+    }
+    paletteLoaded[pid] = PALETTE_DECODED;
+}
+
+// 读取全部子区块重新生成目录、paletteId 列表和占用位图 (旧文件或旧版本目录)
+void rebuildDirectory() {
+    std::vector<SubChunkDirEntry> rebuilt;
+    std::vector<std::vector<PaletteID>> rebuiltIds;
+    std::vector<OccupancyMap> rebuiltOccupancy;
+    rebuilt.reserve(subChunkOffsets.size());
+    rebuiltIds.reserve(subChunkOffsets.size());
+    rebuiltOccupancy.reserve(subChunkOffsets.size());
+    for (size_t i = 0; i < subChunkOffsets.size(); i++) {
+        if (!cachedStream.is_open()) {
+            cachedStream.open(filename, std::ios::binary);
+            if (!cachedStream) {
+                throw std::runtime_error("Failed to reopen file for streaming");
+            }
+        }
+        cachedStream.seekg(subChunkOffsets[i], std::ios::beg);
+        SubChunkSize sz;
+        Coord ox, oy, oz;
+        auto regions = SubChunkUtils::readSubChunk(cachedStream, header.version, sz, ox, oy, oz,
+            expectedChecksum(i));
+
+        std::vector<PaletteID> usedIds;
+        SubChunkDirEntry entry = SubChunkDirectory::summarize(regions, ox, oy, oz, &usedIds);
+        entry.offset = subChunkOffsets[i];
+        entry.subChunkSize = sz;
+        rebuilt.push_back(entry);
+        rebuiltIds.push_back(std::move(usedIds));
+        rebuiltOccupancy.push_back(OccupancyMap::build(regions));
+    }
+    directory = std::move(rebuilt);
+    subChunkPaletteIds = std::move(rebuiltIds);
+    subChunkOccupancy = std::move(rebuiltOccupancy);
+}
+
+public:
+
+// 空间裁剪: 返回与给定世界坐标盒子相交的子区块索引
+// 先按包围盒筛选, 再用占用位图排除盒子只落在空格子里的子区块
+std::vector<size_t> findSubChunksInBox(int x1, int y1, int z1, int x2, int y2, int z2) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    if (z1 > z2) std::swap(z1, z2);
+
+    std::vector<size_t> result;
+    const auto& dir = getSubChunkDirectory();
+    if (subChunkOccupancy.size() != dir.size()) rebuildDirectory();
+    for (size_t i = 0; i < dir.size(); i++) {
+        const SubChunkDirEntry& e = dir[i];
+        if (!SubChunkDirectory::intersects(e, x1, y1, z1, x2, y2, z2)) continue;
+        if (!subChunkOccupancy[i].anyInBox(x1 - e.originX, y1 - e.originY, z1 - e.originZ,
+            x2 - e.originX, y2 - e.originY, z2 - e.originZ)) continue;
+        result.push_back(i);
+    }
+    return result;
+}
+
+// 读取子区块中与世界坐标盒子相交的区域; 盒子只覆盖空格子时不访问文件
+std::vector<BlockRegion> getBlockRegionsInBox(size_t subChunkIndex,
+    int x1, int y1, int z1, int x2, int y2, int z2) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    if (z1 > z2) std::swap(z1, z2);
+
+    const SubChunkDirEntry& e = getSubChunkInfo(subChunkIndex);
+    const int lx1 = x1 - e.originX, ly1 = y1 - e.originY, lz1 = z1 - e.originZ;
+    const int lx2 = x2 - e.originX, ly2 = y2 - e.originY, lz2 = z2 - e.originZ;
+    if (!getSubChunkOccupancy(subChunkIndex).anyInBox(lx1, ly1, lz1, lx2, ly2, lz2)) return {};
+
+    std::vector<BlockRegion> result;
+    for (const auto& r : getBlockRegions(subChunkIndex)) {
+        if (r.x1 <= lx2 && r.x2 >= lx1 && r.y1 <= ly2 && r.y2 >= ly1 && r.z1 <= lz2 && r.z2 >= lz1) {
+            result.push_back(r);
+        }
+    }
+    return result;
+}
+
     // 析构函数确保文件流关闭  
     ~BCFStreamReader() {  
         if (cachedStream.is_open()) {  
@@ -0,0 +1,121 @@
+#pragma once
+#include "Reader/BCFStreamReader.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <numeric>
+
+// 预取得到的子区块
+struct PrefetchedSubChunk {
+    size_t index = 0;
+    SubChunkOrigin origin{};
+    std::vector<BlockRegion> regions;
+};
+
+// 顺序扫描子区块的异步预取器
+// 后台线程使用独立的文件流按顺序读取并解码后续 N 个子区块, 通过有界队列交给调用方,
+// 使 I/O 与解码和调用方的处理重叠。reader 的生命周期必须长于预取器。
+//
+// 用法:
+//   BCFSubChunkPrefetcher prefetcher(reader);
+//   PrefetchedSubChunk sc;
+//   while (prefetcher.next(sc)) { ... }
+class BCFSubChunkPrefetcher {
+private:
+    const BCFStreamReader& reader;
+    std::vector<size_t> indices;   // 待读取的子区块索引 (按顺序)
+    size_t maxQueued;
+
+    std::deque<PrefetchedSubChunk> queue;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    bool producerDone = false;
+    bool stopRequested = false;
+    std::exception_ptr error;
+
+    std::thread worker;
+
+public:
+    // 预取全部子区块
+    explicit BCFSubChunkPrefetcher(const BCFStreamReader& reader, size_t prefetchCount = 8)
+        : BCFSubChunkPrefetcher(reader, allIndices(reader), prefetchCount) {}
+
+    // 只预取指定的子区块 (例如 findSubChunksInBox 的结果)
+    BCFSubChunkPrefetcher(const BCFStreamReader& reader, std::vector<size_t> subChunkIndices,
+        size_t prefetchCount = 8)
+        : reader(reader), indices(std::move(subChunkIndices)),
+        maxQueued(std::max<size_t>(1, prefetchCount)) {
+        worker = std::thread(&BCFSubChunkPrefetcher::run, this);
+    }
+
+    BCFSubChunkPrefetcher(const BCFSubChunkPrefetcher&) = delete;
+    BCFSubChunkPrefetcher& operator=(const BCFSubChunkPrefetcher&) = delete;
+
+    // 取出下一个子区块; 全部读完返回 false, 后台线程的异常在这里重新抛出
+    bool next(PrefetchedSubChunk& out) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !queue.empty() || producerDone; });
+
+        if (queue.empty()) {
+            if (error) std::rethrow_exception(error);
+            return false;
+        }
+
+        out = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    ~BCFSubChunkPrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopRequested = true;
+        }
+        notFull.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+private:
+    static std::vector<size_t> allIndices(const BCFStreamReader& reader) {
+        std::vector<size_t> all(reader.getSubChunkCount());
+        std::iota(all.begin(), all.end(), size_t(0));
+        return all;
+    }
+
+    void run() {
+        try {
+            std::ifstream ifs(reader.getFilename(), std::ios::binary);
+            if (!ifs) {
+                throw std::runtime_error("Failed to open file for prefetching");
+            }
+
+            for (size_t index : indices) {
+                PrefetchedSubChunk sc;
+                sc.index = index;
+                sc.regions = reader.readBlockRegions(ifs, index, sc.origin);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                notFull.wait(lock, [this] { return queue.size() < maxQueued || stopRequested; });
+                if (stopRequested) break;
+                queue.push_back(std::move(sc));
+                lock.unlock();
+                notEmpty.notify_one();
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            producerDone = true;
+        }
+        notEmpty.notify_all();
+    }
+};
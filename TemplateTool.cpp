@@ -2,6 +2,7 @@
 #include <chrono> 
 #include "Writer/BCFCachedWriter.hpp"
 #include "Reader/BCFStreamReader.hpp"
+#include "Reader/BCFSubChunkPrefetcher.hpp"
 #include "APP/McstructureToBCF.hpp"
 #include "APP/SchematicToBCF.hpp"
 #include "APP/LitematicToBCF.hpp"
@@ -76,12 +77,11 @@ int main() {
             size_t totalSubChunks = reader.getSubChunkCount();
             std::cout << "Total sub-chunks: " << totalSubChunks << std::endl;
 
-            //// 按需读取指定的子区块  
-            for (size_t i = 0; i < totalSubChunks; i++) {
-                 std::vector<BlockRegion> blocks = reader.getBlockRegions(i);
-
-
-                std::cout << "Sub-chunk " << i << " has " << blocks.size() << " regions\n";
+            //// 顺序读取子区块 (后台预取)  
+            BCFSubChunkPrefetcher prefetcher(reader);
+            PrefetchedSubChunk subChunk;
+            while (prefetcher.next(subChunk)) {
+                std::cout << "Sub-chunk " << subChunk.index << " has " << subChunk.regions.size() << " regions\n";
             }
             //    auto origin = reader.getSubChunkOrigin(i);
             //    std::cout << i << " origin: " << origin.originX << ", " << origin.originY << ", " << origin.originZ << std::endl;
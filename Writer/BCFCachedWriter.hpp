@@ -4,13 +4,23 @@
 #include "core/SubChunkUtils.hpp"  
 #include "core/BlockUtils.hpp"  
 #include "core/RegionMergeUtils.hpp"
+#include "core/SubChunkDirectory.hpp"
+#include "core/SubChunkCodec.hpp"
+#include "core/Checksum.hpp"
+#include "core/ByteSink.hpp"
+#include "core/ByteCursor.hpp"
+#include "core/Log.hpp"
 #include <fstream>  
 #include <string>  
 #include <map>  
+#include <set>
 #include <vector>  
 #include <filesystem>  
 #include <unordered_map>  
 #include <algorithm>  
+#include <deque>
+#include <future>
+#include <thread>
 #include <io/stream_writer.h>
 #include <iostream>
 struct BlockData {
@@ -57,16 +67,49 @@ std::unordered_map<int, std::ofstream> tempFileHandles;
       
     // 当前活跃的 sub-chunk  
     std::map<int, std::vector<BlockGroup>> activeSubChunks;  
+    // 直接以区域形式加入的数据 (局部坐标), 与 activeSubChunks 使用相同的 sub-chunk 索引
+    std::map<int, std::vector<BlockRegion>> activeRegions;
+    // 待附加的方块 NBT: 子区块索引 -> (局部坐标键 -> NBT), 在 finalize / checkpoint 时写入缓存
+    std::map<int, std::unordered_map<uint32_t, std::shared_ptr<nbt::tag_compound>>> pendingBlockNBT;
+    // 已把附加 NBT 写入 "缓存文件.nbt"、等待替换原缓存的子区块; 检查点写出后才替换
+    std::set<int> stagedCaches;
     size_t maxBlocksInMemory = 25000;  
+
+    // 子区块负载压缩算法与区域布局 (v5)
+    uint8_t subChunkCodec = CODEC_ZLIB;
+    uint8_t subChunkLayout = LAYOUT_ROWS;
+
+    // finalize 时并行编码子区块的线程数 (0 = 按 CPU 核数, 最多 MAX_ENCODE_THREADS)
+    unsigned encodeThreads = 0;
+    static constexpr unsigned MAX_ENCODE_THREADS = 8;
       
     // ID 管理  
     std::unordered_map<PaletteKey, PaletteID, PaletteKeyHash> paletteCache;  
     BlockTypeID nextTypeId = 0;  
     BlockStateID nextStateId = 0;  
 
+    // 检查点: 写过检查点后析构时保留缓存, 供新的 writer 恢复
+    size_t autoCheckpointInterval = 0;   // 每写出多少个缓存片段自动保存一次, 0 = 关闭
+    size_t flushesSinceCheckpoint = 0;
+    bool hasCheckpoint = false;
+    bool staleCheckpointCleared = false;  // 非恢复的 writer 首次写缓存前删除 tempDir 中旧任务的检查点
+    bool cacheWriteFailed = false;        // 缓存写入失败后缓存内容不完整, 不能再保存检查点
+
 private:  
     size_t blockCounter = 0;  
     static constexpr size_t FLUSH_CHECK_INTERVAL = 200;
+
+    // -------------------- 检查点格式 --------------------
+    // tempDir/checkpoint.bin:
+    //   "BCKP" | u8 版本 | string32 progress | 压缩/布局/世界尺寸 | 下一个 ID
+    //   | 类型表 | 状态名表 | 状态值表 | palette (含 NBT) | 待替换的缓存 (子区块索引)
+    //   | 缓存索引 (子区块索引, 有效长度) | u32 CRC32
+    // 缓存文件只追加; 恢复时截断到记录的长度, 丢弃检查点之后写入的片段,
+    // 保证缓存中引用的 paletteId 都在检查点的 palette 中。
+    // 附加 NBT 重写的缓存先写到 "缓存文件.nbt", 检查点记录其长度并列为待替换, 之后才重命名;
+    // 恢复时先完成尚未完成的重命名。
+    static constexpr char CHECKPOINT_MAGIC[4] = { 'B', 'C', 'K', 'P' };
+    static constexpr uint8_t CHECKPOINT_VERSION = 2;
   
 public:  
     BCFCachedWriter(const std::string& filename,
@@ -86,36 +129,23 @@ void addBlock(int x, int y, int z,
     const std::string& blockType,  
     const std::vector<std::pair<std::string, std::string>>& states = {},  
     std::shared_ptr<nbt::tag_compound> nbtData = nullptr) {  // 使用libnbt++类型  
-  
-    int subChunkIndexX = x / 144;
-    int subChunkIndexZ = z / 144;
-
-    if (x < 0 && x % 144 != 0) subChunkIndexX--;
-    if (z < 0 && z % 144 != 0) subChunkIndexZ--;
-
-    // ✅ 推荐配置:不超过 Coord 限制  
-    const int subChunkCountX = 454;  // 支持 ±32,688 的坐标范围  
-    const int offset = 227;          // subChunkCountX / 2  
+    // 获取或创建 IDs (使用优化的 O(1) 查找)      
+    addBlock(x, y, z, registerPalette(blockType, states, std::move(nbtData)));
+}
 
-    int subChunkIndex = (subChunkIndexZ + offset) * subChunkCountX + (subChunkIndexX + offset);
+    // addBlock / addRegion 可表示的世界坐标范围 (闭区间), 超出时抛出 std::runtime_error:
+    // X/Z 由 454 个 144 格的子区块覆盖; Y 的局部坐标为 y - minY, 须能放进 Coord
+static constexpr int MIN_XZ = -227 * 144;
+static constexpr int MAX_XZ = 227 * 144 - 1;
+static constexpr int MAX_LOCAL_Y = 32767;
+int minWorldY() const { return minY; }
+int maxWorldY() const { return minY + MAX_LOCAL_Y; }
 
-    int localX = ((x % 144) + 144) % 144;
-    int localZ = ((z % 144) + 144) % 144;
-    int localY = y + 56;
-    // 获取或创建 IDs (使用优化的 O(1) 查找)      
-    BlockTypeID typeId = getOrCreateTypeId(blockType);      
-  
-    // 构建PaletteKey  
-    PaletteKey key;      
-    key.typeId = typeId;      
-    key.states.reserve(states.size());
-    for (const auto& [stateName, stateValue] : states) {    
-        BlockStateID stateId = getOrCreateStateId(stateName);    
-        StateValueID valueId = getOrCreateStateValue(stateValue);    
-        key.states.push_back({ stateId, valueId });    
-    }    
-    key.nbtData = nbtData;  // 直接存储tag_compound*  
-    PaletteID paletteId = getOrCreatePaletteId(key);      
+    // 按已注册的 PaletteID 写入单个方块, 省去每个方块的字符串查找
+    // 转换器可先用 registerPalette 把源 palette 整体翻译一次, 再逐方块调用此重载
+void addBlock(int x, int y, int z, PaletteID paletteId) {
+    int subChunkIndex, localX, localY, localZ;
+    locateBlock(x, y, z, minY, subChunkIndex, localX, localY, localZ);
   
     // 添加到对应的 sub-chunk      
     auto& subChunk = activeSubChunks[subChunkIndex];      
@@ -126,22 +156,147 @@ void addBlock(int x, int y, int z,
         blockCounter = 0;  
     }  
 }  
+
+    // 分片: 工作线程各自把方块按子区块分组到自己的 Shard 中, 不访问 writer 的任何状态;
+    // 主线程再按固定顺序调用 addShard 并入, 结果与按同样顺序逐个 addBlock 相同。
+    // 转换器可以先用自己的临时编号作为 PaletteID, 并入前用 remapPalette 换成 writer 注册的 ID。
+class Shard {
+public:
+    explicit Shard(int worldMinY) : minY(worldMinY) {}
+
+    void addBlock(int x, int y, int z, PaletteID paletteId) {
+        int subChunkIndex, localX, localY, localZ;
+        locateBlock(x, y, z, minY, subChunkIndex, localX, localY, localZ);
+        addBlockToGroup(subChunks[subChunkIndex], paletteId, localX, localY, localZ);
+        ++blockCount;
+    }
+
+    // 按组替换 PaletteID (每个子区块的每种 palette 只调用一次 fn)
+    template<typename Fn>
+    void remapPalette(Fn&& fn) {
+        for (auto& [subChunkIndex, groups] : subChunks)
+            for (auto& group : groups) group.paletteId = fn(group.paletteId);
+    }
+
+    size_t size() const { return blockCount; }
+
+private:
+    friend class BCFCachedWriter;
+    int minY;
+    std::map<int, std::vector<BlockGroup>> subChunks;
+    size_t blockCount = 0;
+};
+
+    // 新建与本 writer 使用相同 Y 基准的分片 (Shard 本身可以在任意线程中使用)
+Shard makeShard() const { return Shard(minY); }
+
+    // 并入一个分片; 同一子区块中 PaletteID 相同的组追加到已有的组之后
+void addShard(Shard&& shard) {
+    if (shard.minY != minY) throw std::logic_error("Shard was created for a different world minimum Y");
+    for (auto& [subChunkIndex, groups] : shard.subChunks) {
+        auto& subChunk = activeSubChunks[subChunkIndex];
+        for (auto& group : groups) appendGroup(subChunk, std::move(group));
+    }
+    blockCounter += shard.blockCount;
+    shard.subChunks.clear();
+    shard.blockCount = 0;
+    if (blockCounter >= FLUSH_CHECK_INTERVAL) {
+        checkAndFlush();
+        blockCounter = 0;
+    }
+}
+
+    // 给已写入 (或之后写入) 的方块附加 NBT: 该位置的方块改用 "原类型 + 状态 + nbtData" 的 palette 条目。
+    // 用于方块实体晚于方块数据出现的源格式, 转换器不必为此缓存整个方块数组。
+    // 在 finalize / checkpoint 时统一处理, 该位置没有方块时忽略; 同一位置多次附加以最后一次为准。
+    // 与内存中的方块相同, 自动检查点不包含尚未处理的附加 NBT。
+void attachBlockNBT(int x, int y, int z, std::shared_ptr<nbt::tag_compound> nbtData) {
+    int subChunkIndex, localX, localY, localZ;
+    locateBlock(x, y, z, minY, subChunkIndex, localX, localY, localZ);
+    pendingBlockNBT[subChunkIndex][localKey(localX, localY, localZ)] = std::move(nbtData);
+}
+
+    // 设置子区块压缩算法 (CODEC_NONE / CODEC_ZLIB / 自定义注册的编号)
+void setCompression(uint8_t codec) {
+    SubChunkCodec::get(codec);  // 未注册时立即抛出
+    subChunkCodec = codec;
+}
+
+    // 设置子区块区域布局: LAYOUT_ROWS (定长记录) 或 LAYOUT_COLUMNAR (列式增量编码, 体积更小)
+void setRegionLayout(uint8_t layout) {
+    if (layout != LAYOUT_ROWS && layout != LAYOUT_COLUMNAR) {
+        throw std::invalid_argument("Unknown sub-chunk region layout");
+    }
+    subChunkLayout = layout;
+}
+
+    // 获取或创建方块类型+状态+NBT 对应的 PaletteID
+    // 转换器可预先为源 palette 的每个条目调用一次, 之后按 ID 写入
+PaletteID registerPalette(const std::string& blockType,
+    const std::vector<std::pair<std::string, std::string>>& states = {},
+    std::shared_ptr<nbt::tag_compound> nbtData = nullptr) {
+    PaletteKey key;
+    key.typeId = getOrCreateTypeId(blockType);
+    key.states.reserve(states.size());
+    for (const auto& [stateName, stateValue] : states) {
+        BlockStateID stateId = getOrCreateStateId(stateName);
+        StateValueID valueId = getOrCreateStateValue(stateValue);
+        key.states.push_back({ stateId, valueId });
+    }
+    key.nbtData = std::move(nbtData);
+    return getOrCreatePaletteId(key);
+}
+
+    // 直接写入一个长方体区域 (世界坐标, 闭区间), 不展开成单个方块
+    // 跨越 sub-chunk 边界时按边界切分, finalize 时与同 palette 的相邻区域合并
+void addRegion(int x1, int y1, int z1, int x2, int y2, int z2, PaletteID paletteId) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    if (z1 > z2) std::swap(z1, z2);
+
+    // 两个角都经过与 addBlock 相同的定位 (含范围检查), Y 的局部坐标与单个方块一致
+    int firstIndex, lastIndex, localX1, localY1, localZ1, localX2, localY2, localZ2;
+    locateBlock(x1, y1, z1, minY, firstIndex, localX1, localY1, localZ1);
+    locateBlock(x2, y2, z2, minY, lastIndex, localX2, localY2, localZ2);
+
+    const int subChunkCountX = 454;
+    const int offset = 227;
+    const int cx1 = firstIndex % subChunkCountX - offset, cz1 = firstIndex / subChunkCountX - offset;
+    const int cx2 = lastIndex % subChunkCountX - offset, cz2 = lastIndex / subChunkCountX - offset;
+
+    for (int cz = cz1; cz <= cz2; cz++) {
+        for (int cx = cx1; cx <= cx2; cx++) {
+            int baseX = cx * 144;
+            int baseZ = cz * 144;
+            int subChunkIndex = (cz + offset) * subChunkCountX + (cx + offset);
+
+            BlockRegion region;
+            region.paletteId = paletteId;
+            region.x1 = static_cast<Coord>(std::max(x1, baseX) - baseX);
+            region.x2 = static_cast<Coord>(std::min(x2, baseX + 143) - baseX);
+            region.y1 = static_cast<Coord>(localY1);
+            region.y2 = static_cast<Coord>(localY2);
+            region.z1 = static_cast<Coord>(std::max(z1, baseZ) - baseZ);
+            region.z2 = static_cast<Coord>(std::min(z2, baseZ + 143) - baseZ);
+            activeRegions[subChunkIndex].push_back(region);
+        }
+    }
+
+    if (++blockCounter >= FLUSH_CHECK_INTERVAL) {
+        checkAndFlush();
+        blockCounter = 0;
+    }
+}
+
     // 完成写入 
 void finalize() {  
-    // 1. 关闭所有临时文件句柄（优化4：文件句柄缓存）  
-    for (auto& [index, ofs] : tempFileHandles) {  
-        ofs.close();  
-    }  
-    tempFileHandles.clear();  
-      
-    // 2. Flush 所有剩余的 sub-chunk  
-    for (auto& [index, groups] : activeSubChunks) {  
-        flushSubChunkToCache(index, (groups));  
-    }  
-    activeSubChunks.clear();  
-      
-    // 3. 重置计数器（优化2：减少flush检查频率）  
-    blockCounter = 0;  
+    // 1~3. 关闭句柄, flush 所有剩余的 sub-chunk, 重置计数器
+    flushAllToCache();
+    stageBlockNBT();
+
+    // 合并前保存检查点: 合并中途崩溃时可以用新的 writer 恢复后只重跑合并
+    writeCheckpoint("");
+    commitStagedCaches();
       
     // 4. 合并所有缓存文件并写入最终BCF  
     mergeAllCacheFiles();  
@@ -149,6 +304,161 @@ void finalize() {
     // 5. 清理临时文件  
     cleanup();  
 }
+
+    // 把内存中的全部方块写入缓存, 再保存检查点。
+    // progress 由调用方自定义 (例如已处理到的输入位置), resumeFromCheckpoint 时原样返回。
+    // 之后即使进程退出, 另一个进程也可以用相同的 tempDir 恢复并继续添加方块或直接 finalize。
+void checkpoint(const std::string& progress = "") {
+    flushAllToCache();
+    stageBlockNBT();
+    writeCheckpoint(progress);
+    commitStagedCaches();
+}
+
+    // 设置 finalize 时并行编码子区块的线程数 (0 = 自动); 1 表示串行
+    // 每个线程同时持有一个子区块的全部数据, 内存紧张时应调小
+    // 使用自定义压缩算法时, 其 compress 必须可以在多个线程中同时调用
+void setEncodeThreads(unsigned threads) {
+    encodeThreads = threads;
+}
+
+    // 每写出 flushInterval 个缓存片段自动保存一次检查点 (0 = 关闭)
+    // 自动检查点只包含已写入缓存的方块, 仍在内存中的方块恢复后会丢失
+void setAutoCheckpoint(size_t flushInterval) {
+    autoCheckpointInterval = flushInterval;
+    flushesSinceCheckpoint = 0;
+}
+
+    // 从 tempDir 中的检查点恢复 palette、名称表和缓存索引; 没有检查点时返回 false。
+    // 只能在新建的 writer 上、添加任何方块之前调用。
+    // 不恢复的 writer 在第一次写缓存时删除 tempDir 中已有的检查点, 之后就无法再恢复旧任务。
+bool resumeFromCheckpoint(std::string* progress = nullptr) {
+    if (!paletteList.empty() || !activeSubChunks.empty() || !activeRegions.empty()
+        || !subChunkCacheFiles.empty()) {
+        throw std::logic_error("resumeFromCheckpoint must be called on a fresh writer");
+    }
+
+    const std::string path = checkpointPath();
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+    if (!ifs) return false;
+    std::vector<char> data = readFileRange(ifs, 0, static_cast<size_t>(ifs.tellg()));
+    ifs.close();
+
+    if (data.size() < sizeof(CHECKPOINT_MAGIC) + 1 + sizeof(uint32_t)
+        || !std::equal(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + 4, data.data())) {
+        throw std::runtime_error("Invalid checkpoint file: " + path);
+    }
+    uint32_t storedCrc;
+    std::memcpy(&storedCrc, data.data() + data.size() - sizeof(uint32_t), sizeof(uint32_t));
+    if (Checksum::compute(data.data(), data.size() - sizeof(uint32_t)) != storedCrc) {
+        throw std::runtime_error("Checkpoint checksum mismatch: " + path);
+    }
+
+    ByteCursor in(data.data(), data.size() - sizeof(uint32_t));
+    in.skip(sizeof(CHECKPOINT_MAGIC));
+    if (in.u8() != CHECKPOINT_VERSION) {
+        throw std::runtime_error("Unsupported checkpoint version: " + path);
+    }
+    std::string savedProgress = in.string32();
+
+    subChunkCodec = in.u8();
+    subChunkLayout = in.u8();
+    minY = in.get<int32_t>();
+    width = in.u16();
+    length = in.u16();
+    height = in.u16();
+    nextTypeId = in.get<BlockTypeID>();
+    nextStateId = in.get<BlockStateID>();
+    nextStateValueId = in.get<StateValueID>();
+
+    uint32_t typeCount = in.u32();
+    for (uint32_t i = 0; i < typeCount; i++) {
+        BlockTypeID id = in.get<BlockTypeID>();
+        std::string name = in.string32();
+        typeNameToId[name] = id;
+        typeMap[id] = std::move(name);
+    }
+    uint32_t stateCount = in.u32();
+    for (uint32_t i = 0; i < stateCount; i++) {
+        BlockStateID id = in.get<BlockStateID>();
+        std::string name = in.string32();
+        stateNameToId[name] = id;
+        stateMap[id] = std::move(name);
+    }
+    uint32_t valueCount = in.u32();
+    for (uint32_t i = 0; i < valueCount; i++) {
+        StateValueID id = in.get<StateValueID>();
+        std::string value = in.string32();
+        stateValueToId[value] = id;
+        stateValueMap[id] = std::move(value);
+    }
+
+    uint32_t paletteCount = in.u32();
+    paletteList.reserve(paletteCount);
+    for (uint32_t pid = 0; pid < paletteCount; pid++) {
+        PaletteKey key;
+        key.typeId = in.get<BlockTypeID>();
+        uint16_t pairCount = in.u16();
+        key.states.reserve(pairCount);
+        for (uint16_t j = 0; j < pairCount; j++) {
+            BlockStateID sid = in.get<BlockStateID>();
+            StateValueID val = in.get<StateValueID>();
+            key.states.push_back({ sid, val });
+        }
+        std::string nbtStr = in.string32();
+        if (!nbtStr.empty()) {
+            std::istringstream iss(nbtStr);
+            nbt::io::stream_reader reader(iss, endian::little);
+            auto root = reader.read_tag();
+            if (root.second && root.second->get_type() == nbt::tag_type::Compound) {
+                key.nbtData = std::shared_ptr<nbt::tag_compound>(
+                    static_cast<nbt::tag_compound*>(root.second.release()));
+            }
+        }
+        paletteCache[key] = pid;
+        paletteList.push_back(std::move(key));
+    }
+
+    // 检查点写出后、重命名完成前中断: 此时 .nbt 文件才是检查点记录的缓存内容
+    uint32_t stagedCount = in.u32();
+    for (uint32_t i = 0; i < stagedCount; i++) {
+        const std::string cacheFile = cacheFilePath(in.get<int32_t>());
+        if (std::filesystem::exists(cacheFile + ".nbt")) {
+            std::filesystem::rename(cacheFile + ".nbt", cacheFile);
+        }
+    }
+
+    // 缓存文件截断到检查点时的长度, 删除检查点之后才出现的缓存文件
+    std::map<int, std::string> restored;
+    uint32_t cacheCount = in.u32();
+    for (uint32_t i = 0; i < cacheCount; i++) {
+        int index = in.get<int32_t>();
+        uint64_t size = in.u64();
+        std::string cacheFile = cacheFilePath(index);
+        std::error_code ec;
+        uint64_t actual = std::filesystem::file_size(cacheFile, ec);
+        if (ec || actual < size) {
+            throw std::runtime_error("Cache file missing or truncated: " + cacheFile);
+        }
+        if (actual > size) std::filesystem::resize_file(cacheFile, size);
+        restored[index] = cacheFile;
+    }
+    for (const auto& item : std::filesystem::directory_iterator(tempDir)) {
+        const std::string name = item.path().filename().string();
+        if (name.rfind("subchunk_", 0) != 0) continue;
+        bool known = false;
+        for (const auto& [index, cacheFile] : restored) {
+            if (std::filesystem::path(cacheFile).filename() == item.path().filename()) { known = true; break; }
+        }
+        if (!known) std::filesystem::remove(item.path());
+    }
+    subChunkCacheFiles = std::move(restored);
+
+    hasCheckpoint = true;
+    flushesSinceCheckpoint = 0;
+    if (progress) *progress = std::move(savedProgress);
+    return true;
+}
       
 
 //void addBlocks(std::vector<BlockData>& blocks) {  
@@ -202,7 +512,9 @@ void finalize() {
 //}
 
     ~BCFCachedWriter() {  
-        if (!activeSubChunks.empty() || !subChunkCacheFiles.empty()) {  
+        // 有检查点时保留缓存, 由下一个 writer 恢复
+        if (hasCheckpoint) return;
+        if (!activeSubChunks.empty() || !activeRegions.empty() || !subChunkCacheFiles.empty()) {  
             cleanup();  
         }  
     }  
@@ -215,6 +527,9 @@ private:
             return it->second;  
         }  
           
+        if (typeMap.size() > std::numeric_limits<BlockTypeID>::max()) {
+            throw std::runtime_error("Too many distinct block types");
+        }
         BlockTypeID newId = nextTypeId++;  
         typeMap[newId] = blockType;  
         typeNameToId[blockType] = newId;  
@@ -227,6 +542,9 @@ private:
             return it->second;  
         }  
           
+        if (stateMap.size() > std::numeric_limits<BlockStateID>::max()) {
+            throw std::runtime_error("Too many distinct block state names");
+        }
         BlockStateID newId = nextStateId++;  
         stateMap[newId] = stateName;  
         stateNameToId[stateName] = newId;  
@@ -239,6 +557,9 @@ private:
             return it->second;
         }
 
+        if (stateValueMap.size() > std::numeric_limits<StateValueID>::max()) {
+            throw std::runtime_error("Too many distinct block state values");
+        }
         StateValueID newId = nextStateValueId++;
         stateValueMap[newId] = stateValue;
         stateValueToId[stateValue] = newId;
@@ -255,7 +576,49 @@ private:
         paletteCache[key] = newId;  
         return newId;  
     }  
-    void addBlockToGroup(std::vector<BlockGroup>& subChunk,
+    // 世界坐标 -> 子区块索引与局部坐标; 超出 MIN_XZ~MAX_XZ 或局部 Y 超出 0~MAX_LOCAL_Y 时抛出
+    static void locateBlock(int x, int y, int z, int minY,
+        int& subChunkIndex, int& localX, int& localY, int& localZ) {
+        const int64_t ly = static_cast<int64_t>(y) - minY;
+        if (x < MIN_XZ || x > MAX_XZ || z < MIN_XZ || z > MAX_XZ || ly < 0 || ly > MAX_LOCAL_Y) {
+            throw std::runtime_error("Block position out of range: (" + std::to_string(x) + ", "
+                + std::to_string(y) + ", " + std::to_string(z) + ")");
+        }
+        int subChunkIndexX = x / 144;
+        int subChunkIndexZ = z / 144;
+
+        if (x < 0 && x % 144 != 0) subChunkIndexX--;
+        if (z < 0 && z % 144 != 0) subChunkIndexZ--;
+
+        // ✅ 推荐配置:不超过 Coord 限制  
+        const int subChunkCountX = 454;  // 支持 ±32,688 的坐标范围  
+        const int offset = 227;          // subChunkCountX / 2  
+
+        subChunkIndex = (subChunkIndexZ + offset) * subChunkCountX + (subChunkIndexX + offset);
+
+        localX = ((x % 144) + 144) % 144;
+        localZ = ((z % 144) + 144) % 144;
+        localY = static_cast<int>(ly);
+    }
+
+    static uint32_t localKey(int x, int y, int z) {
+        return (static_cast<uint32_t>(y) * 144 + static_cast<uint32_t>(z)) * 144 + static_cast<uint32_t>(x);
+    }
+
+    static void appendGroup(std::vector<BlockGroup>& subChunk, BlockGroup&& group) {
+        for (auto& existing : subChunk) {
+            if (existing.paletteId == group.paletteId) {
+                existing.x.insert(existing.x.end(), group.x.begin(), group.x.end());
+                existing.y.insert(existing.y.end(), group.y.begin(), group.y.end());
+                existing.z.insert(existing.z.end(), group.z.begin(), group.z.end());
+                existing.count = static_cast<BlockCount>(existing.x.size());
+                return;
+            }
+        }
+        subChunk.push_back(std::move(group));
+    }
+
+    static void addBlockToGroup(std::vector<BlockGroup>& subChunk,
         PaletteID paletteId, int x, int y, int z)
     {
         // 1️⃣ 查找已有 BlockGroup
@@ -291,7 +654,7 @@ private:
             subChunk.push_back(std::move(newGroup));
         }
         catch (const std::exception& e) {
-            std::cerr << "Error pushing new BlockGroup: " << e.what() << std::endl;
+            Log::error() << "Error pushing new BlockGroup: " << e.what();
         }
     }
 
@@ -301,13 +664,17 @@ private:
         size_t total = getTotalBlocksInMemory();
         if (total < maxBlocksInMemory) return;
 
-        // 1️⃣ 统计各 sub-chunk 大小
-        std::vector<std::pair<int, size_t>> sizes;
+        // 1️⃣ 统计各 sub-chunk 大小 (区域按条数计)
+        std::map<int, size_t> sizeMap;
         for (const auto& [idx, groups] : activeSubChunks) {
             size_t count = 0;
             for (const auto& g : groups) count += g.count;
-            sizes.push_back({ idx, count });
+            sizeMap[idx] += count;
+        }
+        for (const auto& [idx, regions] : activeRegions) {
+            sizeMap[idx] += regions.size();
         }
+        std::vector<std::pair<int, size_t>> sizes(sizeMap.begin(), sizeMap.end());
 
         // 2️⃣ 按大小降序排序
         std::sort(sizes.begin(), sizes.end(),
@@ -318,18 +685,22 @@ private:
         for (const auto& [idx, size] : sizes) {
             if (total <= target) break;
 
+            // move 出去, 删除原条目，确保不再访问
+            std::vector<BlockGroup> groups;
+            std::vector<BlockRegion> regions;
             auto it = activeSubChunks.find(idx);
             if (it != activeSubChunks.end()) {
-                // move 出去
-                std::vector<BlockGroup> groups;
                 groups.swap(it->second);
-
-                // 删除原条目，确保不再访问
                 activeSubChunks.erase(it);
-
-                // flush
-                flushSubChunkToCache(idx,groups);
             }
+            auto rit = activeRegions.find(idx);
+            if (rit != activeRegions.end()) {
+                regions.swap(rit->second);
+                activeRegions.erase(rit);
+            }
+
+            // flush
+            flushSubChunkToCache(idx, groups, regions);
             total -= size;
         }
     }
@@ -341,38 +712,376 @@ private:
                 total += group.count;  
             }  
         }  
+        for (const auto& [idx, regions] : activeRegions) {
+            total += regions.size();
+        }
         return total;  
     }  
       
 
 
-    void flushSubChunkToCache(int subChunkIndex, std::vector<BlockGroup>& groups) {
+    // 缓存文件由若干片段组成, 每个片段: u32 groupCount | BlockGroup... | u32 regionCount | BlockRegion...
+    void flushSubChunkToCache(int subChunkIndex, std::vector<BlockGroup>& groups,
+        const std::vector<BlockRegion>& regions) {
+        // 没有从检查点恢复时, tempDir 中的 checkpoint.bin 属于别的任务: 本 writer 开始覆盖缓存文件前删掉,
+        // 否则在本 writer 保存自己的检查点之前崩溃, 恢复时会把新缓存当成旧任务的数据
+        if (!hasCheckpoint && !staleCheckpointCleared) {
+            std::error_code ec;
+            std::filesystem::remove(checkpointPath(), ec);
+            staleCheckpointCleared = true;
+        }
+
         try {
             auto& ofs = tempFileHandles[subChunkIndex];
             if (!ofs.is_open()) {
-                std::string cacheFile = tempDir + "/subchunk_" + std::to_string(subChunkIndex) + ".tmp";
-                ofs.open(cacheFile, std::ios::binary | std::ios::app);
+                // 本 writer 第一次写这个子区块时清掉上次遗留的同名文件
+                const bool known = subChunkCacheFiles.count(subChunkIndex) > 0;
+                ofs.open(cacheFilePath(subChunkIndex),
+                    std::ios::binary | (known ? std::ios::app : std::ios::trunc));
                 if (!ofs) throw std::runtime_error("Failed to open cache file");
             }
 
-            write_u32(ofs, static_cast<uint32_t>(groups.size()));
-            for (auto& bg : groups) {
-                BlockUtils::writeBlockGroup(ofs, bg);
-            }
+            // 片段先在内存中序列化, 一次写入
+            ByteSink out(ofs);
+            writeCacheFragment(out, groups, regions);
+            out.flush();
             ofs.close();
-            subChunkCacheFiles[subChunkIndex] =
-                tempDir + "/subchunk_" + std::to_string(subChunkIndex) + ".tmp";
+            subChunkCacheFiles[subChunkIndex] = cacheFilePath(subChunkIndex);
         }
         catch (const std::exception& e) {
-            std::cerr << "flushSubChunkToCache error: " << e.what() << std::endl;
+            // 这批方块已经离开内存, 不能当作已写入继续 (之后的检查点会把它们记成已保存)
+            cacheWriteFailed = true;
+            throw std::runtime_error("Failed to write cache for sub-chunk " + std::to_string(subChunkIndex)
+                + ": " + e.what());
+        }
+
+        if (autoCheckpointInterval && ++flushesSinceCheckpoint >= autoCheckpointInterval) {
+            writeCheckpoint("");
+        }
+    }
+
+    static void writeCacheFragment(ByteSink& out, const std::vector<BlockGroup>& groups,
+        const std::vector<BlockRegion>& regions) {
+        out.u32(static_cast<uint32_t>(groups.size()));
+        for (auto& bg : groups) {
+            BlockUtils::writeBlockGroup(out, bg);
+        }
+        out.u32(static_cast<uint32_t>(regions.size()));
+        out.bytes(regions.data(), regions.size() * sizeof(BlockRegion));
+    }
+
+    // 整个缓存文件读入内存后解码全部片段
+    static void readCacheFragments(const std::string& cacheFile, std::vector<BlockGroup>& groups,
+        std::vector<BlockRegion>& regions) {
+        std::ifstream ifs(cacheFile, std::ios::binary | std::ios::ate);
+        if (!ifs) {
+            throw std::runtime_error("Failed to read cache file: " + cacheFile);
+        }
+        std::vector<char> cacheData = readFileRange(ifs, 0, static_cast<size_t>(ifs.tellg()));
+        ifs.close();
+
+        ByteCursor in(cacheData);
+        while (!in.atEnd()) {
+            uint32_t groupCount = in.u32();
+            for (uint32_t i = 0; i < groupCount; i++) {
+                groups.push_back(BlockUtils::readBlockGroup(in));
+            }
+            uint32_t regionCount = in.u32();
+            size_t oldSize = regions.size();
+            regions.resize(oldSize + regionCount);
+            in.bytes(regions.data() + oldSize, regionCount * sizeof(BlockRegion));
+        }
+    }
+
+    // 把 attachBlockNBT 记录的 NBT 写入缓存: 命中的方块移到带 NBT 的 palette 条目,
+    // 直接写入的区域在命中位置切开。改动的缓存整体写成 "缓存文件.nbt" 中的一个片段, 原缓存不动;
+    // 调用方随后保存检查点 (记录新 palette 与 .nbt 的长度), 再用 commitStagedCaches 替换原缓存,
+    // 任何时刻中断, 检查点都与磁盘上的缓存一致。
+    void stageBlockNBT() {
+        for (auto& [subChunkIndex, attachments] : pendingBlockNBT) {
+            auto cit = subChunkCacheFiles.find(subChunkIndex);
+            if (cit == subChunkCacheFiles.end()) continue;   // 子区块中没有方块
+
+            std::vector<BlockGroup> groups;
+            std::vector<BlockRegion> regions;
+            readCacheFragments(cit->second, groups, regions);
+
+            auto withNBT = [&](PaletteID paletteId, const std::shared_ptr<nbt::tag_compound>& nbtData) {
+                PaletteKey key = paletteList[paletteId];
+                key.nbtData = nbtData;
+                return getOrCreatePaletteId(key);
+            };
+
+            std::vector<BlockGroup> moved;
+            size_t hits = 0;
+            for (auto& group : groups) {
+                size_t keep = 0;
+                for (size_t i = 0; i < group.count; i++) {
+                    auto it = attachments.find(localKey(group.x[i], group.y[i], group.z[i]));
+                    if (it != attachments.end()) {
+                        addBlockToGroup(moved, withNBT(group.paletteId, it->second), group.x[i], group.y[i], group.z[i]);
+                        ++hits;
+                        continue;
+                    }
+                    group.x[keep] = group.x[i];
+                    group.y[keep] = group.y[i];
+                    group.z[keep] = group.z[i];
+                    ++keep;
+                }
+                group.x.resize(keep);
+                group.y.resize(keep);
+                group.z.resize(keep);
+                group.count = static_cast<BlockCount>(keep);
+            }
+
+            // 区域中的命中位置: 把长方体切成不含该点的至多 6 块, 切出的块再检查其余命中点。
+            // 键按 (y, z, x) 排序, 与区域 Y 范围相交的附加位置是一段连续区间
+            if (!regions.empty()) {
+                std::vector<uint32_t> keys;
+                keys.reserve(attachments.size());
+                for (const auto& item : attachments) keys.push_back(item.first);
+                std::sort(keys.begin(), keys.end());
+
+                std::vector<BlockRegion> work;
+                work.swap(regions);
+                while (!work.empty()) {
+                    BlockRegion r = work.back();
+                    work.pop_back();
+
+                    auto it = std::lower_bound(keys.begin(), keys.end(), localKey(0, r.y1, 0));
+                    const uint32_t last = localKey(143, r.y2, 143);
+                    for (; it != keys.end() && *it <= last; ++it) {
+                        Coord x = static_cast<Coord>(*it % 144);
+                        Coord z = static_cast<Coord>(*it / 144 % 144);
+                        if (x >= r.x1 && x <= r.x2 && z >= r.z1 && z <= r.z2) break;
+                    }
+                    if (it == keys.end() || *it > last) {
+                        regions.push_back(r);
+                        continue;
+                    }
+
+                    Coord x = static_cast<Coord>(*it % 144);
+                    Coord z = static_cast<Coord>(*it / 144 % 144);
+                    Coord y = static_cast<Coord>(*it / (144 * 144));
+                    auto push = [&](Coord x1, Coord y1, Coord z1, Coord x2, Coord y2, Coord z2) {
+                        if (x1 <= x2 && y1 <= y2 && z1 <= z2)
+                            work.push_back({ r.paletteId, x1, y1, z1, x2, y2, z2 });
+                    };
+                    push(r.x1, r.y1, r.z1, static_cast<Coord>(x - 1), r.y2, r.z2);
+                    push(static_cast<Coord>(x + 1), r.y1, r.z1, r.x2, r.y2, r.z2);
+                    push(x, r.y1, r.z1, x, static_cast<Coord>(y - 1), r.z2);
+                    push(x, static_cast<Coord>(y + 1), r.z1, x, r.y2, r.z2);
+                    push(x, y, r.z1, x, y, static_cast<Coord>(z - 1));
+                    push(x, y, static_cast<Coord>(z + 1), x, y, r.z2);
+                    addBlockToGroup(moved, withNBT(r.paletteId, attachments.at(*it)), x, y, z);
+                    ++hits;
+                }
+            }
+            if (hits == 0) continue;
+
+            groups.erase(std::remove_if(groups.begin(), groups.end(),
+                [](const BlockGroup& g) { return g.count == 0; }), groups.end());
+            for (auto& group : moved) groups.push_back(std::move(group));
+
+            const std::string stagedPath = cit->second + ".nbt";
+            {
+                std::ofstream ofs(stagedPath, std::ios::binary | std::ios::trunc);
+                if (!ofs) throw std::runtime_error("Failed to create cache file: " + stagedPath);
+                ByteSink out(ofs);
+                writeCacheFragment(out, groups, regions);
+                out.flush();
+                if (!ofs) throw std::runtime_error("Failed to write cache file: " + stagedPath);
+            }
+            syncFileToDisk(stagedPath);
+            stagedCaches.insert(subChunkIndex);
+        }
+        pendingBlockNBT.clear();
+    }
+
+    // 检查点已记录 .nbt 的内容后, 用它们替换原缓存
+    void commitStagedCaches() {
+        for (int index : stagedCaches) {
+            const std::string& cacheFile = subChunkCacheFiles.at(index);
+            std::filesystem::rename(cacheFile + ".nbt", cacheFile);
+        }
+        stagedCaches.clear();
+    }
+
+    std::string cacheFilePath(int subChunkIndex) const {
+        return tempDir + "/subchunk_" + std::to_string(subChunkIndex) + ".tmp";
+    }
+
+    std::string checkpointPath() const { return tempDir + "/checkpoint.bin"; }
+
+    void flushAllToCache() {
+        // 关闭所有临时文件句柄（优化4：文件句柄缓存）  
+        for (auto& [index, ofs] : tempFileHandles) {  
+            ofs.close();  
+        }  
+        tempFileHandles.clear();  
+
+        // Flush 所有剩余的 sub-chunk  
+        for (auto& [index, groups] : activeSubChunks) {  
+            flushSubChunkToCache(index, (groups), activeRegions[index]);
+        }  
+        for (auto& [index, regions] : activeRegions) {
+            if (!activeSubChunks.count(index)) {
+                std::vector<BlockGroup> noGroups;
+                flushSubChunkToCache(index, noGroups, regions);
+            }
+        }
+        activeSubChunks.clear();  
+        activeRegions.clear();
+
+        // 重置计数器（优化2：减少flush检查频率）  
+        blockCounter = 0;  
+    }
+
+    // 保存检查点: 先写 checkpoint.bin.tmp 再重命名, 旧检查点在新检查点完整写出前一直有效
+    void writeCheckpoint(const std::string& progress) {
+        if (cacheWriteFailed) {
+            throw std::logic_error("Cannot save a checkpoint after a failed cache write");
+        }
+        ByteSink out;
+        out.bytes(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        out.u8(CHECKPOINT_VERSION);
+        out.string32(progress);
+
+        out.u8(subChunkCodec);
+        out.u8(subChunkLayout);
+        out.put<int32_t>(minY);
+        out.u16(width);
+        out.u16(length);
+        out.u16(height);
+        out.put(nextTypeId);
+        out.put(nextStateId);
+        out.put(nextStateValueId);
+
+        // 名称按原样保存 (string32 不做编码转换), 恢复后查找键与写入时一致
+        out.u32(static_cast<uint32_t>(typeMap.size()));
+        for (const auto& [id, name] : typeMap) { out.put(id); out.string32(name); }
+        out.u32(static_cast<uint32_t>(stateMap.size()));
+        for (const auto& [id, name] : stateMap) { out.put(id); out.string32(name); }
+        out.u32(static_cast<uint32_t>(stateValueMap.size()));
+        for (const auto& [id, value] : stateValueMap) { out.put(id); out.string32(value); }
+
+        out.u32(static_cast<uint32_t>(paletteList.size()));
+        for (const auto& key : paletteList) {
+            out.put(key.typeId);
+            out.u16(static_cast<uint16_t>(key.states.size()));
+            for (const auto& s : key.states) { out.put(s.first); out.put(s.second); }
+            std::string nbtStr;
+            if (key.nbtData) {
+                std::ostringstream oss;
+                nbt::io::stream_writer writer(oss, endian::little);
+                writer.write_tag("", *key.nbtData);
+                nbtStr = oss.str();
+            }
+            out.string32(nbtStr);
+        }
+
+        out.u32(static_cast<uint32_t>(stagedCaches.size()));
+        for (int index : stagedCaches) out.put<int32_t>(index);
+        out.u32(static_cast<uint32_t>(subChunkCacheFiles.size()));
+        for (const auto& [index, cacheFile] : subChunkCacheFiles) {
+            out.put<int32_t>(index);
+            out.u64(std::filesystem::file_size(stagedCaches.count(index) ? cacheFile + ".nbt" : cacheFile));
+        }
+        out.u32(Checksum::compute(out.data(), out.size()));
+
+        const std::string path = checkpointPath();
+        const std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!ofs) throw std::runtime_error("Failed to create checkpoint: " + tmpPath);
+            ofs.write(out.data(), static_cast<std::streamsize>(out.size()));
+            ofs.close();
+            if (!ofs) throw std::runtime_error("Failed to write checkpoint: " + tmpPath);
         }
+        syncFileToDisk(tmpPath);
+        std::filesystem::rename(tmpPath, path);
+        hasCheckpoint = true;
+        flushesSinceCheckpoint = 0;
     }
 
 
+    // 先写入 outputFilename.partial, 刷到磁盘后再原子重命名为 outputFilename;
+    // 中途失败时删除半成品, outputFilename 保持原状, 缓存文件也保留
     void mergeAllCacheFiles() {
-        std::ofstream ofs(outputFilename, std::ios::binary);
+        const std::string partialFile = outputFilename + ".partial";
+        try {
+            writeMergedFile(partialFile);
+            syncFileToDisk(partialFile);
+            std::filesystem::rename(partialFile, outputFilename);
+            syncParentDirectory(outputFilename);
+        }
+        catch (...) {
+            std::error_code ec;
+            std::filesystem::remove(partialFile, ec);
+            throw;
+        }
+    }
+
+    // 单个子区块的编码结果: 完整的子区块字节及其目录信息
+    struct EncodedSubChunk {
+        std::vector<char> bytes;
+        uint32_t checksum = 0;
+        SubChunkDirEntry entry;
+        std::vector<PaletteID> usedIds;
+        OccupancyMap occupancy;
+    };
+
+    unsigned resolveEncodeThreads() const {
+        if (encodeThreads) return encodeThreads;
+        unsigned hw = std::thread::hardware_concurrency();
+        return std::max(1u, std::min(hw, MAX_ENCODE_THREADS));
+    }
+
+    // 读取一个子区块的缓存文件, 合并为区域并编码; 只读成员, 可在工作线程中并行调用
+    EncodedSubChunk encodeSubChunk(int index, const std::string& cacheFile) const {
+        const int subChunkCountX = 454;
+        const int offset = 227;
+
+        int subChunkX = (index % subChunkCountX) - offset;
+        int subChunkZ = (index / subChunkCountX) - offset;
+
+        Coord originX = static_cast<Coord>(subChunkX * 144);
+        Coord originY = static_cast<Coord>(minY);
+        Coord originZ = static_cast<Coord>(subChunkZ * 144);
+        // 读取所有片段并收集      
+        std::vector<BlockGroup> allGroups;
+        std::vector<BlockRegion> directRegions;
+        readCacheFragments(cacheFile, allGroups, directRegions);
+
+        // 先合并相同 paletteId 的 BlockGroup      
+        allGroups = MergeUtils::mergeBlockGroups(allGroups);
+
+        // 使用 RegionMergeUtils 将 BlockGroup 转换为 BlockRegion      
+        auto mergedRegions = RegionMergeUtils::mergeToRegions(allGroups);
+        std::vector<BlockGroup>().swap(allGroups);
+
+        // 加入直接写入的区域, 并合并同 palette 的相邻长方体
+        if (!directRegions.empty()) {
+            mergedRegions.insert(mergedRegions.end(), directRegions.begin(), directRegions.end());
+            mergedRegions = RegionMergeUtils::coalesceRegions(std::move(mergedRegions));
+        }
+
+        EncodedSubChunk enc;
+        ByteSink sink;
+        SubChunkUtils::writeSubChunkCompressed(sink, mergedRegions, originX, originY, originZ,
+            makeCodecByte(subChunkCodec, subChunkLayout));
+        enc.bytes.assign(sink.data(), sink.data() + sink.size());
+        enc.checksum = Checksum::compute(enc.bytes.data(), enc.bytes.size());
+
+        enc.entry = SubChunkDirectory::summarize(mergedRegions, originX, originY, originZ, &enc.usedIds);
+        enc.occupancy = OccupancyMap::build(mergedRegions);
+        return enc;
+    }
+
+    void writeMergedFile(const std::string& path) {
+        std::ofstream ofs(path, std::ios::binary);
         if (!ofs) {
-            throw std::runtime_error("Failed to create output file: " + outputFilename);
+            throw std::runtime_error("Failed to create output file: " + path);
         }
 
         // ✅ 从 sub-chunk 索引计算实际边界  
@@ -409,123 +1118,149 @@ private:
         header.length = static_cast<uint16_t>(finalLength);
         header.height = height;
         write_le<BCFHeader>(ofs, header);
+
+        // 之后的输出都经过缓冲, 按大块写入文件
+        ByteSink out(ofs);
         // 按顺序处理所有 sub-chunk      
         std::vector<FilePos> subChunkOffsets;
+        std::vector<SubChunkDirEntry> directory;
+        std::vector<std::vector<PaletteID>> directoryPaletteIds;
+        std::vector<uint32_t> subChunkChecksums;
+        std::vector<OccupancyMap> subChunkOccupancy;
+        directory.reserve(subChunkCacheFiles.size());
+        directoryPaletteIds.reserve(subChunkCacheFiles.size());
 
-        for (const auto& [index, cacheFile] : subChunkCacheFiles) {
-            subChunkOffsets.push_back(ofs.tellp());
-            const int subChunkCountX = 454;
-            const int offset = 227;
+        // 子区块之间互不依赖: 工作线程并行读取缓存、合并区域并压缩,
+        // 主线程按索引顺序写出, 同时在途的子区块不超过线程数
+        std::vector<std::pair<int, std::string>> jobs(subChunkCacheFiles.begin(), subChunkCacheFiles.end());
+        const size_t window = resolveEncodeThreads();
+        std::deque<std::future<EncodedSubChunk>> pending;
+        size_t nextJob = 0;
+        auto launchNext = [&]() {
+            const auto& job = jobs[nextJob++];
+            pending.push_back(std::async(std::launch::async,
+                [this, &job]() { return encodeSubChunk(job.first, job.second); }));
+        };
+        while (nextJob < jobs.size() && pending.size() < window) launchNext();
 
-            int subChunkX = (index % subChunkCountX) - offset;
-            int subChunkZ = (index / subChunkCountX) - offset;
+        while (!pending.empty()) {
+            EncodedSubChunk enc = pending.front().get();
+            pending.pop_front();
+            if (nextJob < jobs.size()) launchNext();
 
-            Coord originX = static_cast<Coord>(subChunkX * 144);
-            Coord originY = static_cast<Coord>(minY);
-            Coord originZ = static_cast<Coord>(subChunkZ * 144);
-            // 读取所有片段并合并  
-            std::ifstream ifs(cacheFile, std::ios::binary);
-            if (!ifs) {
-                throw std::runtime_error("Failed to read cache file: " + cacheFile);
-            }
+            subChunkOffsets.push_back(out.tell());
+            out.bytes(enc.bytes.data(), enc.bytes.size());
+            subChunkChecksums.push_back(enc.checksum);
 
-            std::vector<BlockGroup> allGroups;
+            // 记录目录条目 (起点、大小、包围盒、palette 使用情况)
+            enc.entry.offset = subChunkOffsets.back();
+            enc.entry.subChunkSize = static_cast<SubChunkSize>(enc.bytes.size());
+            directory.push_back(enc.entry);
+            directoryPaletteIds.push_back(std::move(enc.usedIds));
+            subChunkOccupancy.push_back(enc.occupancy);
+            out.commit();
+        }
 
-            // 读取所有片段并收集      
-            while (ifs.peek() != EOF) {
-                uint32_t groupCount = read_u32(ifs);
-                for (uint32_t i = 0; i < groupCount; i++) {
-                    allGroups.push_back(BlockUtils::readBlockGroup(ifs));
-                }
-            }
-            ifs.close();
+        // 写入子区块偏移量表 (从这里到文件尾之前的元数据整体计算一个 CRC32)
+        FilePos offsetTablePos = out.tell();
+        out.beginChecksum();
+        out.u64(subChunkOffsets.size());
+        out.bytes(subChunkOffsets.data(), subChunkOffsets.size() * sizeof(FilePos));
 
-            // 先合并相同 paletteId 的 BlockGroup      
-            allGroups = MergeUtils::mergeBlockGroups(allGroups);
+        // 子区块目录紧跟偏移量表
+        SubChunkDirectory::write(out, directory, directoryPaletteIds, subChunkChecksums, subChunkOccupancy);
+        out.commit();
 
-            // 使用 RegionMergeUtils 将 BlockGroup 转换为 BlockRegion      
-            auto mergedRegions = RegionMergeUtils::mergeToRegions(allGroups);
+        // NBT 堆: 所有 NBT 依次存放, 偏移和长度记录在 palette 索引中
+        FilePos nbtHeapPos = out.tell();
+        std::vector<PaletteIndexEntry> paletteIndex(paletteList.size());
+        for (size_t pid = 0; pid < paletteList.size(); pid++) {
+            const auto& k = paletteList[pid];
+            if (!k.nbtData) continue;
 
-            // 传递三个坐标参数      
-            SubChunkUtils::writeSubChunk(ofs, mergedRegions, originX, originY, originZ);
-        }
+            std::ostringstream oss;
+            nbt::io::stream_writer writer(oss, endian::little);
+            writer.write_tag("", *k.nbtData);  // 保持使用 write_tag,写入完整格式  
+            std::string nbtStr = oss.str();
 
-        // 写入子区块偏移量表  
-        FilePos offsetTablePos = ofs.tellp();
-        write_u64(ofs, subChunkOffsets.size());
-        for (auto offset : subChunkOffsets) {
-            write_u64(ofs, offset);
+            paletteIndex[pid].nbtOffset = out.tell();
+            paletteIndex[pid].nbtSize = static_cast<uint32_t>(nbtStr.size());
+            out.bytes(nbtStr.data(), nbtStr.size());
+            out.commit();
         }
 
-        // 写入 palette 时序列化 NBT 数据  
-        FilePos palettePos = ofs.tellp();
-        write_u32(ofs, static_cast<uint32_t>(paletteList.size()));
+        // 写入 palette: 数量 | 定长索引 (先占位, 记录写完后回填) | 变长记录
+        // 回填前不调用 commit, 索引一直留在缓冲中
+        FilePos palettePos = out.tell();
+        out.u32(static_cast<uint32_t>(paletteList.size()));
+        FilePos paletteIndexPos = out.tell();
+        out.bytes(paletteIndex.data(), paletteIndex.size() * sizeof(PaletteIndexEntry));
         for (size_t pid = 0; pid < paletteList.size(); pid++) {
             const auto& k = paletteList[pid];
+            paletteIndex[pid].recordOffset = out.tell();
 
-            // 记录写入前的位置  
-            FilePos beforeEntry = ofs.tellp();
-
-            write_u32(ofs, static_cast<uint32_t>(pid));
-            write_u16(ofs, k.typeId);
-            write_u16(ofs, static_cast<uint16_t>(k.states.size()));
+            out.u32(static_cast<uint32_t>(pid));
+            out.u16(k.typeId);
+            out.u16(static_cast<uint16_t>(k.states.size()));
             for (const auto& s : k.states) {
-                write_u8(ofs, s.first);
-                write_u8(ofs, s.second);
+                out.varint(s.first);
+                out.varint(s.second);
             }
-
-            // 记录 NBT 写入前的位置  
-            FilePos beforeNBT = ofs.tellp();
-
-            if (k.nbtData) {
-                std::ostringstream oss;
-                nbt::io::stream_writer writer(oss, endian::little);
-                writer.write_tag("", *k.nbtData);  // 保持使用 write_tag,写入完整格式  
-                std::string nbtStr = oss.str();
-                writeString32(ofs, nbtStr);
-            }
-            else {
-                writeString32(ofs, "");  // 空NBT数据    
-            }
-
         }
+        for (size_t pid = 0; pid < paletteIndex.size(); pid++) {
+            out.patch<PaletteIndexEntry>(paletteIndexPos + pid * sizeof(PaletteIndexEntry), paletteIndex[pid]);
+        }
+        out.commit();
+
         // 写入类型名映射  
-        FilePos typeMapPos = ofs.tellp();
-        write_u32(ofs, static_cast<uint32_t>(typeMap.size()));
+        FilePos typeMapPos = out.tell();
+        out.u32(static_cast<uint32_t>(typeMap.size()));
         for (const auto& kv : typeMap) {
-            write_u16(ofs, kv.first);
-            writeString16(ofs, kv.second);
+            out.u16(kv.first);
+            out.string16(kv.second);
         }
 
         // 写入状态映射  
-        FilePos stateMapPos = ofs.tellp();
-        write_u32(ofs, static_cast<uint32_t>(stateMap.size()));
+        FilePos stateMapPos = out.tell();
+        out.u32(static_cast<uint32_t>(stateMap.size()));
         for (const auto& kv : stateMap) {
-            write_u8(ofs, kv.first);
-            writeString16(ofs, kv.second);
+            out.varint(kv.first);
+            out.string16(kv.second);
         }
 
         // 写入 state value map      
-        FilePos stateValueMapPos = ofs.tellp();
-        write_u32(ofs, static_cast<uint32_t>(stateValueMap.size()));
+        FilePos stateValueMapPos = out.tell();
+        out.u32(static_cast<uint32_t>(stateValueMap.size()));
         for (const auto& kv : stateValueMap) {
-            write_u8(ofs, kv.first);
-            writeString16(ofs, kv.second);
+            out.varint(kv.first);
+            out.string16(kv.second);
         }
+        uint32_t metadataCrc = out.endChecksum();
 
-        // 更新 header (版本升级到 4)      
-        header.version = 4;
+        // 更新 header (版本 8: 校验和与文件尾)      
+        header.version = 8;
         header.subChunkCount = subChunkOffsets.size();
         header.subChunkOffsetsTableOffset = offsetTablePos;
         header.paletteOffset = palettePos;
         header.blockTypeMapOffset = typeMapPos;
         header.stateNameMapOffset = stateMapPos;
         header.stateValueMapOffset = stateValueMapPos;
-        header.nbtDataOffset = 0;  // NBT 数据嵌入在 palette 中  
+        header.nbtDataOffset = nbtHeapPos;
+
+        // 文件尾最后写出, 读取器据此判断文件是否完整
+        BCFFooter footer;
+        footer.headerCrc = Checksum::compute(&header, sizeof(header));
+        footer.metadataCrc = metadataCrc;
+        footer.fileSize = out.tell() + sizeof(BCFFooter);
+        out.put(footer);
+        out.flush();
 
         ofs.seekp(0);
         write_le<BCFHeader>(ofs, header);
         ofs.close();
+        if (!ofs) {
+            throw std::runtime_error("Failed to write output file: " + path);
+        }
     }
 
 
@@ -542,9 +1277,14 @@ private:
             try {  
                 std::filesystem::remove(cacheFile);  
             } catch (std::exception& e) {
-               std::cerr << "Failed to remove cache file: " << e.what() << std::endl;
+               Log::warn() << "Failed to remove cache file: " << e.what();
             }  
         }  
+
+        // 输出完成后检查点不再需要
+        std::error_code ec;
+        std::filesystem::remove(checkpointPath(), ec);
+        hasCheckpoint = false;
           
         // 删除临时目录  
         try {  
@@ -553,7 +1293,7 @@ private:
                 std::filesystem::remove(tempDir);  
             }  
         } catch (std::exception& e) {
-            std::cerr << "Failed to remove temp directory: " << e.what() << std::endl;
+            Log::warn() << "Failed to remove temp directory: " << e.what();
         }  
           
         subChunkCacheFiles.clear();  
@@ -0,0 +1,54 @@
+// BCF 读取计时: 生成一个固定内容的测试文件, 多次计时"打开文件 + 读取全部子区块", 输出最好成绩。
+// 用法: ReaderBench [输出文件=bench.bcf] [palette 条目数=400000] [重复次数=5]
+// 每个方块使用不同的 palette 条目, 区域不会合并, 区域数与 palette 条目数相同。
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "Writer/BCFCachedWriter.hpp"
+#include "Reader/BCFStreamReader.hpp"
+
+static void generate(const std::string& filename, size_t paletteCount) {
+    BCFCachedWriter writer(filename, "./temp_bcf_bench", 1000000);
+    for (size_t i = 0; i < paletteCount; i++) {
+        PaletteID id = writer.registerPalette("minecraft:stone", { { "bench_id", std::to_string(i) } });
+        // 方块间隔 2 格, 铺满若干子区块
+        int x = static_cast<int>(i % 360) * 2;
+        int z = static_cast<int>(i / 360 % 360) * 2;
+        int y = static_cast<int>(i / (360 * 360)) * 2 - 56;
+        writer.addBlock(x, y, z, id);
+    }
+    writer.finalize();
+}
+
+int main(int argc, char** argv) {
+    const std::string filename = argc > 1 ? argv[1] : "bench.bcf";
+    const size_t paletteCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 400000;
+    const int runs = argc > 3 ? std::max(1, std::atoi(argv[3])) : 5;
+
+    try {
+        generate(filename, paletteCount);
+
+        double best = 0;
+        size_t regionCount = 0;
+        for (int run = 0; run < runs; run++) {
+            auto start = std::chrono::steady_clock::now();
+            BCFStreamReader reader(filename);
+            regionCount = 0;
+            for (size_t i = 0; i < reader.getSubChunkCount(); i++) {
+                regionCount += reader.getBlockRegions(i).size();
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (run == 0 || elapsed.count() < best) best = elapsed.count();
+        }
+
+        std::cout << "palette: " << paletteCount << ", regions: " << regionCount
+            << ", open + read all sub-chunks: " << best << " s (best of " << runs << ")" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "ReaderBench: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <nbt_tags.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+// -------------------- 方块实体位置索引 --------------------
+// 各转换器在写入方块前先读入源文件的方块实体, 按局部坐标建表, 写方块时按坐标查找 NBT。
+// 每轴取低 21 位打包为一个 64 位键 (负坐标按补码截断, 范围 ±1048575 内不冲突)。
+using BlockEntityMap = std::unordered_map<uint64_t, std::shared_ptr<nbt::tag_compound>>;
+
+inline uint64_t blockPositionKey(int x, int y, int z) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x) & 0x1FFFFF) << 42)
+        | (static_cast<uint64_t>(static_cast<uint32_t>(y) & 0x1FFFFF) << 21)
+        | (static_cast<uint64_t>(static_cast<uint32_t>(z) & 0x1FFFFF));
+}
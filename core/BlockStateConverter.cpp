@@ -1,5 +1,5 @@
 #include "BlockStateConverter.hpp"
-//#include "block_state_data.hpp"  // ñ
+//#include "block_state_data.hpp"  // 内置表
 
 bool BlockStateConverter::loadFromStream(std::istream& in) {
     std::string line;
@@ -18,7 +18,7 @@ bool BlockStateConverter::loadFromStream(std::istream& in) {
         }
     }
 
-    std::cout << " " << javaToBedrockMap.size() << " ת" << std::endl;
+    Log::info() << "加载了 " << javaToBedrockMap.size() << " 条转换规则";
     return true;
 }
 
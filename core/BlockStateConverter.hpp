@@ -6,18 +6,22 @@
 #include <sstream>  
 #include <iostream>  
 #include <unordered_set>
+#include <algorithm>
+#include "Log.hpp"
 
 class BlockStateConverter {
 private:
     // 使用完整的方块字符串作为键  
     std::unordered_map<std::string, std::string> javaToBedrockMap;
+    // 未找到映射的方块 -> 查询次数; 转换过程中只计数, 结束时由 reportMissing 汇总输出
+    std::unordered_map<std::string, size_t> missingBlocks;
 
 public:
     // 从文件加载转换表  
     bool loadFromFile(const std::string& filename) {
         std::ifstream file(filename);
         if (!file) {
-            std::cerr << "无法打开转换表文件: " << filename << std::endl;
+            Log::error() << "无法打开转换表文件: " << filename;
             return false;
         }
 
@@ -46,7 +50,7 @@ public:
             }
         }
 
-        std::cout << "加载了 " << javaToBedrockMap.size() << " 条转换规则" << std::endl;
+        Log::info() << "加载了 " << javaToBedrockMap.size() << " 条转换规则";
         return true;
     }
 
@@ -71,16 +75,34 @@ public:
             return parseBlockString(it->second);
         }
 
-        // ⚠️ 仅打印一次未找到的方块  
-        static std::unordered_set<std::string> missingBlocks;  // 记录已输出的未匹配方块
-
-        if (missingBlocks.insert(fullJavaBlock).second) { // insert 返回 pair<iterator, bool>，bool 表示是否新插入
-            std::cout << "未找到匹配的 Bedrock 方块: " << fullJavaBlock << std::endl;
-        }
+        // 未找到: 记录下来, 不在热路径中输出
+        ++missingBlocks[fullJavaBlock];
 
         // 返回原始方块（无转换）
         return { javaBlockName, javaStates };
     }
+    // 未找到映射的不同方块数量
+    size_t missingCount() const { return missingBlocks.size(); }
+
+    // 汇总输出未找到映射的方块 (按查询次数降序, 最多 maxEntries 条)
+    void reportMissing(size_t maxEntries = 50) const {
+        if (missingBlocks.empty()) return;
+
+        std::vector<std::pair<std::string, size_t>> sorted(missingBlocks.begin(), missingBlocks.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+
+        Log::warn() << "未找到匹配的 Bedrock 方块 " << sorted.size() << " 种 (保留原始方块):";
+        size_t shown = std::min(maxEntries, sorted.size());
+        for (size_t i = 0; i < shown; ++i) {
+            Log::warn() << "  " << sorted[i].first << " x" << sorted[i].second;
+        }
+        if (shown < sorted.size()) {
+            Log::warn() << "  ... 另有 " << (sorted.size() - shown) << " 种未列出";
+        }
+    }
+
 private:
     // 去除首尾空格  
     std::string trim(const std::string& str) {
@@ -1,61 +1,64 @@
 #pragma once
 #include "bcf_structs.hpp"
 #include "bcf_io.hpp"
+#include "ByteSink.hpp"
+#include "ByteCursor.hpp"
 #include <fstream>
 #include <unordered_map>
-// -------------------- BlockGroup  --------------------
+// -------------------- BlockGroup 工具 --------------------
 struct BlockUtils {
 
-    // һ鵽 BlockGroup
+    // 添加一个方块到 BlockGroup
     static void addBlock(BlockGroup& bg, Coord x, Coord y, Coord z) {
         bg.x.push_back(x); bg.y.push_back(y); bg.z.push_back(z);
         bg.count = static_cast<BlockCount>(bg.x.size());
     }
 
-    // ȡ BlockGroup ĵ idx 
+    // 读取 BlockGroup 的第 idx 个方块
     static void getBlock(const BlockGroup& bg, size_t idx, Coord& x, Coord& y, Coord& z) {
         x = bg.x[idx]; y = bg.y[idx]; z = bg.z[idx];
     }
 
-    // д BlockGroup ļ
-    static void writeBlockGroup(std::ofstream& ofs, const BlockGroup& bg) {
+    // 写 BlockGroup 到文件
+    static void writeBlockGroup(ByteSink& out, const BlockGroup& bg) {
         if (bg.x.size() < bg.count || bg.y.size() < bg.count || bg.z.size() < bg.count) {
             throw std::runtime_error("BlockGroup array size mismatch");
         }
-        write_u32(ofs, bg.paletteId);
-        write_u32(ofs, bg.count);
+        out.u32(bg.paletteId);
+        out.u32(bg.count);
         for (size_t i = 0; i < bg.count; i++) {
-            write_i16(ofs, bg.x[i]);
-            write_i16(ofs, bg.y[i]);
-            write_i16(ofs, bg.z[i]);
+            out.i16(bg.x[i]);
+            out.i16(bg.y[i]);
+            out.i16(bg.z[i]);
         }
     }
 
-    // ļȡ BlockGroup
-    static BlockGroup readBlockGroup(std::ifstream& ifs) {
+    // 从文件读取 BlockGroup
+    static BlockGroup readBlockGroup(ByteCursor& in) {
         BlockGroup bg;
-        bg.paletteId = read_u32(ifs);
-        bg.count = read_u32(ifs);
+        bg.paletteId = in.u32();
+        bg.count = in.u32();
+        in.require(static_cast<size_t>(bg.count) * 3 * sizeof(Coord));
         bg.x.resize(bg.count); bg.y.resize(bg.count); bg.z.resize(bg.count);
         for (size_t i = 0; i < bg.count; i++) {
-            bg.x[i] = read_i16(ifs);
-            bg.y[i] = read_i16(ifs);
-            bg.z[i] = read_i16(ifs);
+            bg.x[i] = in.getUnchecked<Coord>();
+            bg.y[i] = in.getUnchecked<Coord>();
+            bg.z[i] = in.getUnchecked<Coord>();
         }
         return bg;
     }
 };
 
 
-// -------------------- һԺϲ BlockGroup --------------------
+// -------------------- 一次性合并子区块内 BlockGroup --------------------
 struct MergeUtils {
 
-    // ע⣺PaletteID ʾ type+state ϣڴֻ PaletteIDֱ
+    // 注意：PaletteID 表示 type+state 的组合，如果你在内存里只有 PaletteID，可以直接用
     static std::vector<BlockGroup> mergeBlockGroups(const std::vector<BlockGroup>& groups) {
         std::unordered_map<PaletteID, BlockGroup> merged;
 
         for (const auto& bg : groups) {
-            auto& target = merged[bg.paletteId];  // Զ
+            auto& target = merged[bg.paletteId];  // 自动创建
             target.paletteId = bg.paletteId;
             target.x.insert(target.x.end(), bg.x.begin(), bg.x.end());
             target.y.insert(target.y.end(), bg.y.begin(), bg.y.end());
@@ -63,7 +66,7 @@ struct MergeUtils {
             target.count = static_cast<BlockCount>(target.x.size());
         }
 
-        // ת vector 
+        // 转成 vector 返回
         std::vector<BlockGroup> result;
         result.reserve(merged.size());
         for (auto& kv : merged) result.push_back(kv.second);
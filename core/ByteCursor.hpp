@@ -0,0 +1,97 @@
+#pragma once
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bcf_structs.hpp"
+
+// -------------------- 内存字节游标 --------------------
+// 在内存 (或 mmap) 缓冲上解码 BCF 数据, 与 ByteSink 对应。
+// get 系列逐字段检查边界; 定长记录可先 require(n) 一次检查, 再用 getUnchecked 连续解码。
+// 游标不拥有数据, 缓冲的生命周期由调用方保证。
+class ByteCursor {
+public:
+    ByteCursor(const char* data, size_t size) : begin(data), cur(data), end(data + size) {}
+    explicit ByteCursor(const std::vector<char>& buffer)
+        : ByteCursor(buffer.data(), buffer.size()) {}
+
+    size_t position() const { return static_cast<size_t>(cur - begin); }
+    size_t remaining() const { return static_cast<size_t>(end - cur); }
+    bool atEnd() const { return cur >= end; }
+
+    void seek(size_t pos) {
+        if (pos > static_cast<size_t>(end - begin)) throw std::runtime_error("BCF cursor seek out of range");
+        cur = begin + pos;
+    }
+
+    void require(size_t n) const {
+        if (n > remaining()) throw std::runtime_error("Unexpected end of BCF data");
+    }
+
+    template<typename T> T getUnchecked() {
+        T v;
+        std::memcpy(&v, cur, sizeof(T));
+        cur += sizeof(T);
+        return v;
+    }
+
+    template<typename T> T get() {
+        require(sizeof(T));
+        return getUnchecked<T>();
+    }
+
+    uint8_t u8() { return get<uint8_t>(); }
+    uint16_t u16() { return get<uint16_t>(); }
+    uint32_t u32() { return get<uint32_t>(); }
+    uint64_t u64() { return get<uint64_t>(); }
+    int16_t i16() { return get<int16_t>(); }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = u8();
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return v;
+        }
+        throw std::runtime_error("Malformed varint");
+    }
+
+    // 返回当前位置的 n 个字节并前进 (指向原缓冲, 不复制)
+    const char* take(size_t n) {
+        require(n);
+        const char* p = cur;
+        cur += n;
+        return p;
+    }
+
+    void skip(size_t n) { take(n); }
+
+    void bytes(void* out, size_t n) {
+        if (n) std::memcpy(out, take(n), n);
+    }
+
+    std::string string16() {
+        uint16_t len = u16();
+        return std::string(take(len), len);
+    }
+
+    std::string string32() {
+        uint32_t len = u32();
+        return std::string(take(len), len);
+    }
+
+private:
+    const char* begin;
+    const char* cur;
+    const char* end;
+};
+
+// 把文件中 [offset, offset + size) 读入内存, 供 ByteCursor 解码
+inline std::vector<char> readFileRange(std::ifstream& ifs, FilePos offset, size_t size) {
+    std::vector<char> buffer(size);
+    ifs.seekg(offset, std::ios::beg);
+    if (size) ifs.read(buffer.data(), static_cast<std::streamsize>(size));
+    if (!ifs) throw std::runtime_error("Failed to read BCF data at offset " + std::to_string(offset));
+    return buffer;
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bcf_structs.hpp"
+#include "TextEncoding.hpp"
+#include "Checksum.hpp"
+#include "Log.hpp"
+
+// -------------------- 缓冲字节输出 --------------------
+// 所有 BCF 输出先序列化到连续内存, 再整块写入文件, 避免每个字段一次 ofstream::write。
+// 需要回填的字段 (如子区块大小) 先写占位值, 之后用 patch 按文件偏移回填;
+// commit 只在缓冲超过阈值时才写出, 所以两次 commit 之间写入的占位都可以回填。
+class ByteSink {
+public:
+    static constexpr size_t DEFAULT_FLUSH_THRESHOLD = 4u << 20;
+
+    // 纯内存模式: 写完后用 data()/size() 取走
+    ByteSink() = default;
+
+    // 文件模式: 从文件当前位置开始追加
+    explicit ByteSink(std::ofstream& ofs, size_t flushThreshold = DEFAULT_FLUSH_THRESHOLD)
+        : ofs(&ofs), flushThreshold(flushThreshold) {
+        std::streampos pos = ofs.tellp();
+        flushedBytes = pos < 0 ? 0 : static_cast<FilePos>(pos);
+        buffer.reserve(flushThreshold + (flushThreshold >> 2));
+    }
+
+    ByteSink(const ByteSink&) = delete;
+    ByteSink& operator=(const ByteSink&) = delete;
+
+    ~ByteSink() {
+        try { flush(); }
+        catch (const std::exception& e) {
+            Log::error() << "ByteSink flush error: " << e.what();
+        }
+    }
+
+    // 当前写入位置 (文件模式下为文件偏移)
+    FilePos tell() const { return flushedBytes + buffer.size(); }
+
+    template<typename T> void put(const T& v) {
+        size_t at = buffer.size();
+        buffer.resize(at + sizeof(T));
+        std::memcpy(buffer.data() + at, &v, sizeof(T));
+    }
+
+    void u8(uint8_t v) { buffer.push_back(static_cast<char>(v)); }
+    void u16(uint16_t v) { put(v); }
+    void u32(uint32_t v) { put(v); }
+    void u64(uint64_t v) { put(v); }
+    void i16(int16_t v) { put(v); }
+
+    void varint(uint64_t v) {
+        while (v >= 0x80) {
+            buffer.push_back(static_cast<char>((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        buffer.push_back(static_cast<char>(v));
+    }
+
+    void bytes(const void* data, size_t size) {
+        if (size == 0) return;
+        const char* p = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), p, p + size);
+    }
+
+    // 与 writeString16 相同: 先规范为 UTF-8, 长度上限 65535
+    void string16(const std::string& str) {
+        std::string u8str = ensure_utf8(str);
+        if (u8str.size() > 0xFFFF) {
+            throw std::runtime_error(
+                "String length exceeds the maximum allowed 65535 for BCF writeString16 (after UTF-8 normalization).");
+        }
+        u16(static_cast<uint16_t>(u8str.size()));
+        bytes(u8str.data(), u8str.size());
+    }
+
+    void string32(const std::string& str) {
+        u32(static_cast<uint32_t>(str.size()));
+        bytes(str.data(), str.size());
+    }
+
+    // 回填 pos 处的字段; pos 必须仍在缓冲中 (上次写出之后)
+    template<typename T> void patch(FilePos pos, const T& v) {
+        if (pos < flushedBytes || pos + sizeof(T) > tell()) {
+            throw std::logic_error("ByteSink patch position already flushed");
+        }
+        std::memcpy(buffer.data() + (pos - flushedBytes), &v, sizeof(T));
+    }
+
+    // 从当前位置开始计算 CRC32, endChecksum 返回期间写入的全部字节的校验和
+    // 期间可以 commit/flush, 已写出的部分在写出时累加; 同一时间只有一段校验
+    void beginChecksum() {
+        checksumActive = true;
+        checksumFrom = tell();
+        runningCrc = 0;
+    }
+
+    uint32_t endChecksum() {
+        if (!checksumActive) throw std::logic_error("ByteSink checksum not started");
+        foldChecksum();
+        checksumActive = false;
+        return runningCrc;
+    }
+
+    // 一条完整记录写完后调用: 缓冲超过阈值时写出
+    void commit() {
+        if (ofs && buffer.size() >= flushThreshold) flush();
+    }
+
+    void flush() {
+        if (!ofs || buffer.empty()) return;
+        if (checksumActive) foldChecksum();
+        ofs->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!*ofs) throw std::runtime_error("Failed to write BCF output");
+        flushedBytes += buffer.size();
+        buffer.clear();
+    }
+
+    const char* data() const { return buffer.data(); }
+    size_t size() const { return buffer.size(); }
+    void clear() { buffer.clear(); }
+
+private:
+    // 把 [checksumFrom, tell()) 累加进 runningCrc
+    void foldChecksum() {
+        size_t from = static_cast<size_t>(checksumFrom - flushedBytes);
+        runningCrc = Checksum::update(runningCrc, buffer.data() + from, buffer.size() - from);
+        checksumFrom = tell();
+    }
+
+    std::ofstream* ofs = nullptr;
+    size_t flushThreshold = DEFAULT_FLUSH_THRESHOLD;
+    FilePos flushedBytes = 0;
+    std::vector<char> buffer;
+
+    bool checksumActive = false;
+    FilePos checksumFrom = 0;
+    uint32_t runningCrc = 0;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <zlib.h>
+
+// -------------------- 校验和 --------------------
+// BCF v8 的子区块与文件尾校验使用 CRC32 (zlib 实现, 与 zip/png 相同的多项式)
+struct Checksum {
+    static uint32_t update(uint32_t crc, const void* data, size_t size) {
+        const Bytef* p = static_cast<const Bytef*>(data);
+        uLong value = crc;
+        // zlib 的长度参数为 uInt, 超大数据分段计算
+        while (size > 0) {
+            uInt n = static_cast<uInt>(std::min<size_t>(size, std::numeric_limits<uInt>::max()));
+            value = crc32(value, p, n);
+            p += n;
+            size -= n;
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    static uint32_t compute(const void* data, size_t size) { return update(0, data, size); }
+};
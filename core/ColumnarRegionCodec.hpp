@@ -0,0 +1,196 @@
+#pragma once
+#include "bcf_structs.hpp"
+#include "PaletteFilter.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// -------------------- 列式区域编码 --------------------
+// 子区块负载的可选布局 (codec 字节高 4 位 = LAYOUT_COLUMNAR):
+//   区域按 (y1, z1, x1) 排序后按列存放, 所有整数均为 LEB128 varint
+//   [u32 paletteRunCount] [runCount 对 (paletteId, runLength)]
+//   [y1 增量] [z1 增量 zigzag] [x1 增量 zigzag] [x 尺寸] [y 尺寸] [z 尺寸]
+//   尺寸 = 结束坐标 - 起始坐标, 按 y 层排序后 y 增量非负, z/x 在换行时可能为负
+// 解码按列批量进行, varint 带 8 字节一组的单字节快速路径。
+struct ColumnarRegionCodec {
+
+    static std::vector<char> encode(std::vector<BlockRegion> regions) {
+        std::sort(regions.begin(), regions.end(), [](const BlockRegion& a, const BlockRegion& b) {
+            if (a.y1 != b.y1) return a.y1 < b.y1;
+            if (a.z1 != b.z1) return a.z1 < b.z1;
+            return a.x1 < b.x1;
+        });
+
+        std::vector<char> out;
+        out.reserve(regions.size() * 8 + 16);
+
+        // paletteId 游程
+        std::vector<std::pair<PaletteID, uint32_t>> runs;
+        for (const auto& r : regions) {
+            if (!runs.empty() && runs.back().first == r.paletteId) runs.back().second++;
+            else runs.push_back({ r.paletteId, 1 });
+        }
+        putVarint(out, runs.size());
+        for (const auto& [id, len] : runs) {
+            putVarint(out, id);
+            putVarint(out, len);
+        }
+
+        // 起始坐标增量
+        Coord prevY = 0, prevZ = 0, prevX = 0;
+        for (const auto& r : regions) { putVarint(out, static_cast<uint32_t>(r.y1 - prevY)); prevY = r.y1; }
+        for (const auto& r : regions) { putVarint(out, zigzag(r.z1 - prevZ)); prevZ = r.z1; }
+        for (const auto& r : regions) { putVarint(out, zigzag(r.x1 - prevX)); prevX = r.x1; }
+
+        // 尺寸
+        for (const auto& r : regions) putVarint(out, static_cast<uint32_t>(r.x2 - r.x1));
+        for (const auto& r : regions) putVarint(out, static_cast<uint32_t>(r.y2 - r.y1));
+        for (const auto& r : regions) putVarint(out, static_cast<uint32_t>(r.z2 - r.z1));
+        return out;
+    }
+
+    static std::vector<BlockRegion> decode(const char* data, size_t size, BlockCount regionCount) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        const uint8_t* end = p + size;
+
+        std::vector<BlockRegion> regions(regionCount);
+
+        // paletteId 游程展开
+        uint32_t runCount = getVarint(p, end);
+        size_t filled = 0;
+        for (uint32_t i = 0; i < runCount; i++) {
+            PaletteID id = getVarint(p, end);
+            uint32_t len = getVarint(p, end);
+            if (len > regionCount - filled) throw std::runtime_error("Corrupt columnar palette runs");
+            for (uint32_t k = 0; k < len; k++) regions[filled++].paletteId = id;
+        }
+        if (filled != regionCount) throw std::runtime_error("Corrupt columnar palette runs");
+
+        // 每列批量解码到临时数组, 再做前缀和
+        std::vector<uint32_t> column(regionCount);
+
+        decodeColumn(p, end, column);
+        int32_t acc = 0;
+        for (size_t i = 0; i < regionCount; i++) { acc += static_cast<int32_t>(column[i]); regions[i].y1 = static_cast<Coord>(acc); }
+
+        decodeColumn(p, end, column);
+        acc = 0;
+        for (size_t i = 0; i < regionCount; i++) { acc += unzigzag(column[i]); regions[i].z1 = static_cast<Coord>(acc); }
+
+        decodeColumn(p, end, column);
+        acc = 0;
+        for (size_t i = 0; i < regionCount; i++) { acc += unzigzag(column[i]); regions[i].x1 = static_cast<Coord>(acc); }
+
+        decodeColumn(p, end, column);
+        for (size_t i = 0; i < regionCount; i++) regions[i].x2 = static_cast<Coord>(regions[i].x1 + column[i]);
+        decodeColumn(p, end, column);
+        for (size_t i = 0; i < regionCount; i++) regions[i].y2 = static_cast<Coord>(regions[i].y1 + column[i]);
+        decodeColumn(p, end, column);
+        for (size_t i = 0; i < regionCount; i++) regions[i].z2 = static_cast<Coord>(regions[i].z1 + column[i]);
+
+        return regions;
+    }
+
+    // 只解码 paletteId 命中过滤器的区域: 先展开 paletteId 游程确定要保留的下标,
+    // 全部未命中时直接返回, 不再解码坐标列; 坐标列仍需完整前缀和, 但只写出保留的区域
+    static std::vector<BlockRegion> decodeFiltered(const char* data, size_t size, BlockCount regionCount,
+        const PaletteFilter& filter) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        const uint8_t* end = p + size;
+
+        std::vector<uint32_t> keep;
+        std::vector<BlockRegion> regions;
+        uint32_t runCount = getVarint(p, end);
+        size_t filled = 0;
+        for (uint32_t i = 0; i < runCount; i++) {
+            PaletteID id = getVarint(p, end);
+            uint32_t len = getVarint(p, end);
+            if (len > regionCount - filled) throw std::runtime_error("Corrupt columnar palette runs");
+            if (filter.test(id)) {
+                for (uint32_t k = 0; k < len; k++) keep.push_back(static_cast<uint32_t>(filled + k));
+                regions.resize(regions.size() + len);
+                for (size_t k = regions.size() - len; k < regions.size(); k++) regions[k].paletteId = id;
+            }
+            filled += len;
+        }
+        if (filled != regionCount) throw std::runtime_error("Corrupt columnar palette runs");
+        if (keep.empty()) return regions;
+
+        std::vector<uint32_t> column(regionCount);
+        const size_t kept = keep.size();
+
+        decodeColumn(p, end, column);
+        int32_t acc = 0;
+        for (size_t i = 0, j = 0; j < kept; i++) {
+            acc += static_cast<int32_t>(column[i]);
+            if (keep[j] == i) regions[j++].y1 = static_cast<Coord>(acc);
+        }
+
+        decodeColumn(p, end, column);
+        acc = 0;
+        for (size_t i = 0, j = 0; j < kept; i++) {
+            acc += unzigzag(column[i]);
+            if (keep[j] == i) regions[j++].z1 = static_cast<Coord>(acc);
+        }
+
+        decodeColumn(p, end, column);
+        acc = 0;
+        for (size_t i = 0, j = 0; j < kept; i++) {
+            acc += unzigzag(column[i]);
+            if (keep[j] == i) regions[j++].x1 = static_cast<Coord>(acc);
+        }
+
+        decodeColumn(p, end, column);
+        for (size_t j = 0; j < kept; j++) regions[j].x2 = static_cast<Coord>(regions[j].x1 + column[keep[j]]);
+        decodeColumn(p, end, column);
+        for (size_t j = 0; j < kept; j++) regions[j].y2 = static_cast<Coord>(regions[j].y1 + column[keep[j]]);
+        decodeColumn(p, end, column);
+        for (size_t j = 0; j < kept; j++) regions[j].z2 = static_cast<Coord>(regions[j].z1 + column[keep[j]]);
+
+        return regions;
+    }
+
+private:
+    static uint32_t zigzag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+    static int32_t unzigzag(uint32_t v) { return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1); }
+
+    static void putVarint(std::vector<char>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<char>(v));
+    }
+
+    static uint32_t getVarint(const uint8_t*& p, const uint8_t* end) {
+        uint32_t value = 0;
+        int shift = 0;
+        while (true) {
+            if (p >= end || shift > 28) throw std::runtime_error("Corrupt columnar varint");
+            uint8_t byte = *p++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+            shift += 7;
+        }
+    }
+
+    // 批量解码一列 varint: 连续 8 个字节都没有续位时一次输出 8 个值
+    static void decodeColumn(const uint8_t*& p, const uint8_t* end, std::vector<uint32_t>& column) {
+        size_t i = 0;
+        const size_t n = column.size();
+        while (i < n) {
+            if (n - i >= 8 && end - p >= 8) {
+                uint64_t word;
+                std::memcpy(&word, p, 8);
+                if ((word & 0x8080808080808080ULL) == 0) {
+                    for (int k = 0; k < 8; k++) column[i + k] = p[k];
+                    p += 8;
+                    i += 8;
+                    continue;
+                }
+            }
+            column[i++] = getVarint(p, end);
+        }
+    }
+};
@@ -0,0 +1,273 @@
+#pragma once
+#include "LegacyBlockIds.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// -------------------- 旧版 (ID, 数据值) -> 基岩版方块 --------------------
+// MCEdit / Schematica 的 .schematic 来自 Java 版: 0~255 按 Java 1.12 的 ID 与数据值含义解释,
+// 转为扁平化后的基岩版方块名和方块状态 (方向、半砖上下、木材/颜色变种、生长阶段等)。
+// 256 以上只会通过 AddBlocks 出现 (模组方块), 这里一律视为未知, 由转换器按文件自带的 ID 映射处理。
+// 整张表在进程内第一次使用时构建一次, 之后按 (ID, 数据值) 直接查表。
+struct LegacyBlockState {
+    std::string name;                                          // 含 minecraft: 前缀
+    std::vector<std::pair<std::string, std::string>> states;   // <状态名, 状态值>
+};
+
+class LegacyBlockTranslator {
+public:
+    enum class Kind : uint8_t {
+        Unknown = 0,
+        Air = 1,
+        Block = 2,
+    };
+
+    static const LegacyBlockTranslator& instance() {
+        static const LegacyBlockTranslator translator;
+        return translator;
+    }
+
+    Kind kind(int id, int data) const {
+        int32_t i = entryOf(id, data);
+        return i >= 0 ? Kind::Block : (i == AIR_INDEX ? Kind::Air : Kind::Unknown);
+    }
+
+    // 仅对 Kind::Block 调用
+    const LegacyBlockState& state(int id, int data) const {
+        return entries[static_cast<size_t>(entryOf(id, data))];
+    }
+
+private:
+    static constexpr int32_t UNKNOWN_INDEX = -1;
+    static constexpr int32_t AIR_INDEX = -2;
+
+    using States = std::vector<std::pair<std::string, std::string>>;
+
+    LegacyBlockTranslator() : index(static_cast<size_t>(LegacyBlocks::ID_COUNT) * LegacyBlocks::DATA_COUNT, UNKNOWN_INDEX) {
+        for (int id = 0; id < LegacyBlocks::ID_COUNT; ++id) {
+            if (id == 0) {
+                for (int d = 0; d < LegacyBlocks::DATA_COUNT; ++d) index[LegacyBlocks::key(0, d)] = AIR_INDEX;
+                continue;
+            }
+            for (int d = 0; d < LegacyBlocks::DATA_COUNT; ++d) {
+                LegacyBlockState s = translate(id, d);
+                if (s.name.empty()) continue;
+                index[LegacyBlocks::key(id, d)] = static_cast<int32_t>(entries.size());
+                entries.push_back(std::move(s));
+            }
+        }
+    }
+
+    int32_t entryOf(int id, int data) const {
+        if (id < 0 || id >= LegacyBlocks::ID_COUNT) return UNKNOWN_INDEX;
+        return index[LegacyBlocks::key(id, data)];
+    }
+
+    static LegacyBlockState block(const std::string& name, States states = {}) {
+        return { "minecraft:" + name, std::move(states) };
+    }
+    static std::string bit(int v) { return v ? "true" : "false"; }
+    static std::string num(int v) { return std::to_string(v); }
+    static const char* pick(const char* const* names, int count, int i) {
+        return names[i >= 0 && i < count ? i : 0];
+    }
+
+    static bool isStairs(int id) {
+        switch (id) {
+        case 53: case 67: case 108: case 109: case 114: case 128: case 134: case 135:
+        case 136: case 156: case 163: case 164: case 180: case 203:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Java 1.12 数据值 -> 基岩版状态
+    static LegacyBlockState translate(int id, int d) {
+        static const char* const COLORS[16] = { "white", "orange", "magenta", "light_blue", "yellow", "lime", "pink", "gray",
+            "light_gray", "cyan", "purple", "blue", "brown", "green", "red", "black" };
+        static const char* const WOODS[6] = { "oak", "spruce", "birch", "jungle", "acacia", "dark_oak" };
+        static const char* const AXES[4] = { "y", "x", "z", "y" };
+        static const char* const STONES[7] = { "stone", "granite", "polished_granite", "diorite", "polished_diorite",
+            "andesite", "polished_andesite" };
+        static const char* const SLABS[8] = { "smooth_stone", "sandstone", "petrified_oak", "cobblestone", "brick",
+            "stone_brick", "nether_brick", "quartz" };
+        static const char* const FLOWERS[9] = { "poppy", "blue_orchid", "allium", "azure_bluet", "red_tulip",
+            "orange_tulip", "white_tulip", "pink_tulip", "oxeye_daisy" };
+        static const char* const DOUBLE_PLANTS[6] = { "sunflower", "lilac", "tall_grass", "large_fern", "rose_bush", "peony" };
+        static const char* const INFESTED[6] = { "infested_stone", "infested_cobblestone", "infested_stone_bricks",
+            "infested_mossy_stone_bricks", "infested_cracked_stone_bricks", "infested_chiseled_stone_bricks" };
+        static const char* const TORCH_FACING[6] = { "top", "west", "east", "north", "south", "top" };
+        static const char* const LEVER_DIRECTIONS[8] = { "down_east_west", "east", "west", "south", "north",
+            "up_north_south", "up_east_west", "down_north_south" };
+        // Java facing (下 上 北 南 西 东) -> 基岩版 facing_direction; 活塞水平方向相反, 按钮按附着面编号
+        static const int PISTON_FACING[8] = { 0, 1, 3, 2, 5, 4, 0, 0 };
+        static const int BUTTON_FACING[8] = { 0, 5, 4, 3, 2, 1, 0, 0 };
+        static const int GLAZED_FACING[4] = { 3, 4, 2, 5 };
+        static const int BEETROOT_GROWTH[4] = { 0, 3, 4, 7 };
+
+        if (isStairs(id)) {
+            return block(LegacyBlocks::name(id), { { "weirdo_direction", num(d & 3) }, { "upside_down_bit", bit(d & 4) } });
+        }
+        if (id >= 219 && id <= 234) return block(std::string(COLORS[id - 219]) + "_shulker_box");
+        if (id >= 235 && id <= 250) {
+            // 基岩版淡灰色带釉陶瓦沿用旧名 silver_glazed_terracotta, 其余颜色与 Java 版相同
+            std::string color = id == 243 ? "silver" : COLORS[id - 235];
+            return block(color + "_glazed_terracotta", { { "facing_direction", num(GLAZED_FACING[d & 3]) } });
+        }
+
+        switch (id) {
+        case 1: return block(pick(STONES, 7, d));
+        case 2: return block("grass_block");
+        case 3: return block(d == 1 ? "coarse_dirt" : d == 2 ? "podzol" : "dirt");
+        case 5: return block(std::string(pick(WOODS, 6, d)) + "_planks");
+        case 6: return block(std::string(pick(WOODS, 6, d & 7)) + "_sapling", { { "age_bit", bit(d & 8) } });
+        case 8: case 9: case 10: case 11: return block(LegacyBlocks::name(id), { { "liquid_depth", num(d) } });
+        case 12: return block(d == 1 ? "red_sand" : "sand");
+        case 17: case 162: {
+            std::string wood = id == 17 ? WOODS[d & 3] : pick(WOODS + 4, 2, d & 3);
+            int axis = (d >> 2) & 3;
+            return block(wood + (axis == 3 ? "_wood" : "_log"), { { "pillar_axis", AXES[axis] } });
+        }
+        case 18: case 161: {
+            std::string wood = id == 18 ? WOODS[d & 3] : pick(WOODS + 4, 2, d & 3);
+            return block(wood + "_leaves", { { "persistent_bit", bit(d & 4) }, { "update_bit", bit(d & 8) } });
+        }
+        case 19: return block((d & 1) ? "wet_sponge" : "sponge");
+        case 23: case 158:
+            return block(id == 23 ? "dispenser" : "dropper", { { "facing_direction", num(d & 7) }, { "triggered_bit", bit(d & 8) } });
+        case 24: return block(d == 1 ? "chiseled_sandstone" : d == 2 ? "cut_sandstone" : "sandstone");
+        case 26: return block("bed", { { "direction", num(d & 3) }, { "occupied_bit", bit(d & 4) }, { "head_piece_bit", bit(d & 8) } });
+        case 27: case 28: case 157:
+            return block(id == 27 ? "golden_rail" : id == 28 ? "detector_rail" : "activator_rail",
+                { { "rail_direction", num(d & 7) }, { "rail_data_bit", bit(d & 8) } });
+        case 29: case 33:
+            return block(id == 29 ? "sticky_piston" : "piston", { { "facing_direction", num(PISTON_FACING[d & 7]) } });
+        case 34:
+            return block((d & 8) ? "sticky_piston_arm_collision" : "piston_arm_collision",
+                { { "facing_direction", num(PISTON_FACING[d & 7]) } });
+        case 31: return block(d == 0 ? "deadbush" : d == 2 ? "fern" : "short_grass");
+        case 35: return block(std::string(COLORS[d]) + "_wool");
+        case 36: return block("moving_block");
+        case 37: return block("dandelion");
+        case 38: return block(pick(FLOWERS, 9, d));
+        case 43: return block(std::string(SLABS[d & 7]) + "_double_slab", { { "minecraft:vertical_half", "bottom" } });
+        case 44: return block(std::string(SLABS[d & 7]) + "_slab", { { "minecraft:vertical_half", (d & 8) ? "top" : "bottom" } });
+        case 50: case 75: case 76:
+            return block(LegacyBlocks::name(id), { { "torch_facing_direction", pick(TORCH_FACING, 6, d) } });
+        case 51: return block("fire", { { "age", num(d) } });
+        case 54: case 61: case 62: case 65: case 68: case 130: case 146:
+            return block(LegacyBlocks::name(id), { { "facing_direction", num(d < 2 || d > 5 ? 2 : d) } });
+        case 55: return block("redstone_wire", { { "redstone_signal", num(d) } });
+        case 59: case 141: case 142: return block(LegacyBlocks::name(id), { { "growth", num(d & 7) } });
+        case 60: return block("farmland", { { "moisturized_amount", num(d & 7) } });
+        case 63: case 176: return block(LegacyBlocks::name(id), { { "ground_sign_direction", num(d) } });
+        case 177: return block("wall_banner", { { "facing_direction", num(d < 2 || d > 5 ? 2 : d) } });
+        case 64: case 71: case 193: case 194: case 195: case 196: case 197:
+            if (d & 8) {
+                return block(LegacyBlocks::name(id), { { "direction", "0" }, { "open_bit", "false" },
+                    { "upper_block_bit", "true" }, { "door_hinge_bit", bit(d & 1) } });
+            }
+            return block(LegacyBlocks::name(id), { { "direction", num(d & 3) }, { "open_bit", bit(d & 4) },
+                { "upper_block_bit", "false" }, { "door_hinge_bit", "false" } });
+        case 66: return block("rail", { { "rail_direction", num(d > 9 ? 0 : d) } });
+        case 69: return block("lever", { { "lever_direction", LEVER_DIRECTIONS[d & 7] }, { "open_bit", bit(d & 8) } });
+        case 70: case 72: return block(LegacyBlocks::name(id), { { "redstone_signal", num((d & 1) ? 15 : 0) } });
+        case 147: case 148: case 151: case 178: return block(LegacyBlocks::name(id), { { "redstone_signal", num(d) } });
+        case 77: case 143:
+            return block(LegacyBlocks::name(id), { { "facing_direction", num(BUTTON_FACING[d & 7]) }, { "button_pressed_bit", bit(d & 8) } });
+        case 78: return block("snow_layer", { { "height", num(d & 7) }, { "covered_bit", "false" } });
+        case 81: case 83: return block(LegacyBlocks::name(id), { { "age", num(d) } });
+        case 85: return block("oak_fence");
+        case 188: return block("spruce_fence");
+        case 189: return block("birch_fence");
+        case 190: return block("jungle_fence");
+        case 191: return block("dark_oak_fence");
+        case 192: return block("acacia_fence");
+        case 86: case 91: return block(LegacyBlocks::name(id), { { "direction", num(d & 3) } });
+        case 90: return block("portal", { { "portal_axis", d == 2 ? "z" : "x" } });
+        case 92: return block("cake", { { "bite_counter", num(d > 6 ? 6 : d) } });
+        case 93: case 94:
+            return block(LegacyBlocks::name(id), { { "direction", num(d & 3) }, { "repeater_delay", num(d >> 2) } });
+        case 95: return block(std::string(COLORS[d]) + "_stained_glass");
+        case 160: return block(std::string(COLORS[d]) + "_stained_glass_pane");
+        case 159: return block(std::string(COLORS[d]) + "_terracotta");
+        case 171: return block(std::string(COLORS[d]) + "_carpet");
+        case 251: return block(std::string(COLORS[d]) + "_concrete");
+        case 252: return block(std::string(COLORS[d]) + "_concrete_powder");
+        case 96: case 167:
+            // Java: 0 北 1 南 2 西 3 东; 基岩版: 0 东 1 西 2 南 3 北
+            return block(id == 96 ? "trapdoor" : "iron_trapdoor", { { "direction", num(3 - (d & 3)) },
+                { "open_bit", bit(d & 4) }, { "upside_down_bit", bit(d & 8) } });
+        case 97: return block(pick(INFESTED, 6, d));
+        case 98: return block(d == 1 ? "mossy_stone_bricks" : d == 2 ? "cracked_stone_bricks" : d == 3 ? "chiseled_stone_bricks" : "stone_bricks");
+        case 99: case 100: return block(LegacyBlocks::name(id), { { "huge_mushroom_bits", num(d) } });
+        case 104: case 105: return block(LegacyBlocks::name(id), { { "growth", num(d & 7) }, { "facing_direction", "0" } });
+        case 106: return block("vine", { { "vine_direction_bits", num(d) } });
+        case 107: case 183: case 184: case 185: case 186: case 187:
+            return block(LegacyBlocks::name(id), { { "direction", num(d & 3) }, { "open_bit", bit(d & 4) }, { "in_wall_bit", "false" } });
+        case 115: return block("nether_wart", { { "age", num(d & 3) } });
+        case 117:
+            return block("brewing_stand", { { "brewing_stand_slot_a_bit", bit(d & 1) },
+                { "brewing_stand_slot_b_bit", bit(d & 2) }, { "brewing_stand_slot_c_bit", bit(d & 4) } });
+        case 118: return block("cauldron", { { "fill_level", num((d & 3) * 2) }, { "cauldron_liquid", "water" } });
+        case 120: return block("end_portal_frame", { { "direction", num(d & 3) }, { "end_portal_eye_bit", bit(d & 4) } });
+        case 125: return block(std::string(pick(WOODS, 6, d & 7)) + "_double_slab", { { "minecraft:vertical_half", "bottom" } });
+        case 126: return block(std::string(pick(WOODS, 6, d & 7)) + "_slab", { { "minecraft:vertical_half", (d & 8) ? "top" : "bottom" } });
+        case 127: return block("cocoa", { { "direction", num(d & 3) }, { "age", num((d >> 2) & 3) } });
+        case 131:
+            return block("tripwire_hook", { { "direction", num(d & 3) }, { "attached_bit", bit(d & 4) }, { "powered_bit", bit(d & 8) } });
+        case 132:
+            return block("trip_wire", { { "powered_bit", bit(d & 1) }, { "attached_bit", bit(d & 4) }, { "disarmed_bit", bit(d & 8) } });
+        case 137: case 210: case 211:
+            return block(LegacyBlocks::name(id), { { "facing_direction", num(d & 7) }, { "conditional_bit", bit(d & 8) } });
+        case 139: return block(d == 1 ? "mossy_cobblestone_wall" : "cobblestone_wall");
+        case 144: return block("skeleton_skull", { { "facing_direction", num(d & 7) } });
+        case 145: {
+            int damage = (d >> 2) & 3;
+            return block(damage == 1 ? "chipped_anvil" : damage == 2 ? "damaged_anvil" : "anvil", { { "direction", num(d & 3) } });
+        }
+        case 149: case 150:
+            return block(LegacyBlocks::name(id), { { "direction", num(d & 3) },
+                { "output_subtract_bit", bit(d & 4) }, { "output_lit_bit", bit(d & 8) } });
+        case 154: return block("hopper", { { "facing_direction", num(d & 7) }, { "toggle_bit", bit(d & 8) } });
+        case 155:
+            if (d == 1) return block("chiseled_quartz_block");
+            if (d >= 2 && d <= 4) return block("quartz_pillar", { { "pillar_axis", AXES[d - 2] } });
+            return block("quartz_block");
+        case 165: return block("slime");
+        case 168: return block(d == 1 ? "prismarine_bricks" : d == 2 ? "dark_prismarine" : "prismarine");
+        case 169: return block("sea_lantern");
+        case 170: case 216: return block(LegacyBlocks::name(id), { { "pillar_axis", AXES[(d >> 2) & 3] } });
+        // 上半部分 (d & 8) 的低位是朝向而不是种类, 调用方应传入 "下半部分的种类 | 8"
+        case 175: return block(pick(DOUBLE_PLANTS, 6, d & 7), { { "upper_block_bit", bit(d & 8) } });
+        case 179: return block(d == 1 ? "chiseled_red_sandstone" : d == 2 ? "cut_red_sandstone" : "red_sandstone");
+        case 181: return block("red_sandstone_double_slab", { { "minecraft:vertical_half", "bottom" } });
+        case 182: return block("red_sandstone_slab", { { "minecraft:vertical_half", (d & 8) ? "top" : "bottom" } });
+        case 198: return block("end_rod", { { "facing_direction", num(d & 7) } });
+        case 199: return block("chorus_plant");
+        case 200: return block("chorus_flower", { { "age", num(d & 7) } });
+        case 202: return block("purpur_pillar", { { "pillar_axis", AXES[(d >> 2) & 3] } });
+        case 204: return block("purpur_double_slab", { { "minecraft:vertical_half", "bottom" } });
+        case 205: return block("purpur_slab", { { "minecraft:vertical_half", (d & 8) ? "top" : "bottom" } });
+        case 207: return block("beetroot", { { "growth", num(BEETROOT_GROWTH[d & 3]) } });
+        case 212: return block("frosted_ice", { { "age", num(d & 3) } });
+        case 218: return block("observer", { { "facing_direction", num(d & 7) }, { "powered_bit", bit(d & 8) } });
+        case 253: case 254: return {};     // Java 版未使用
+        case 255: {
+            static const char* const MODES[4] = { "save", "load", "corner", "data" };
+            return block("structure_block", { { "structure_block_type", MODES[d & 3] } });
+        }
+        default:
+            break;
+        }
+
+        const char* legacyName = LegacyBlocks::name(id);
+        if (legacyName == nullptr) return {};
+        return block(legacyName);
+    }
+
+    std::vector<int32_t> index;                // (ID, 数据值) -> entries 下标, 或 UNKNOWN_INDEX / AIR_INDEX
+    std::vector<LegacyBlockState> entries;
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+// -------------------- 分级日志 --------------------
+// 各转换器共用。Info 写到 std::cout, Warn/Error 写到 std::cerr;
+// 每条消息先在本地拼好, 加锁后整行输出, 多线程时不会交错。
+// Debug 只在定义 BCF_DEBUG_LOG 时编译, 否则 Log::debug() 的调用整体被优化掉;
+// 运行期可用 Log::setLevel 提高输出门槛。
+// 热路径中可能大量重复的消息用 LogLimiter 限流, 超出部分只计数, 结束时汇总一条。
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3,
+    Off = 4,
+};
+
+namespace Log {
+#if defined(BCF_DEBUG_LOG)
+    constexpr bool DEBUG_ENABLED = true;
+#else
+    constexpr bool DEBUG_ENABLED = false;
+#endif
+
+    inline std::atomic<uint8_t>& levelSetting() {
+        static std::atomic<uint8_t> level{ static_cast<uint8_t>(DEBUG_ENABLED ? LogLevel::Debug : LogLevel::Info) };
+        return level;
+    }
+
+    inline void setLevel(LogLevel level) { levelSetting().store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+    inline LogLevel level() { return static_cast<LogLevel>(levelSetting().load(std::memory_order_relaxed)); }
+
+    inline bool enabled(LogLevel l) {
+        if (l == LogLevel::Debug && !DEBUG_ENABLED) return false;
+        return l != LogLevel::Off && static_cast<uint8_t>(l) >= levelSetting().load(std::memory_order_relaxed);
+    }
+
+    inline void write(LogLevel l, const std::string& message) {
+        static std::mutex outputMutex;
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (l >= LogLevel::Warn) {
+            std::cerr << message << '\n';
+            std::cerr.flush();
+        }
+        else {
+            std::cout << message << '\n';
+        }
+    }
+
+    // 一条日志: Log::info() << a << b; 在语句结束 (析构) 时输出
+    class Line {
+    public:
+        explicit Line(LogLevel l) : level(l), active(enabled(l)) {}
+        Line(const Line&) = delete;
+        Line& operator=(const Line&) = delete;
+        ~Line() {
+            if (active) write(level, buffer.str());
+        }
+
+        template<typename T> Line& operator<<(const T& value) {
+            if (active) buffer << value;
+            return *this;
+        }
+
+    private:
+        LogLevel level;
+        bool active;
+        std::ostringstream buffer;
+    };
+
+    // 编译期关闭的级别: 什么也不做
+    struct NullLine {
+        explicit NullLine(LogLevel) {}
+        template<typename T> NullLine& operator<<(const T&) { return *this; }
+    };
+
+    using DebugLine = std::conditional_t<DEBUG_ENABLED, Line, NullLine>;
+
+    inline DebugLine debug() { return DebugLine(LogLevel::Debug); }
+    inline Line info() { return Line(LogLevel::Info); }
+    inline Line warn() { return Line(LogLevel::Warn); }
+    inline Line error() { return Line(LogLevel::Error); }
+}
+
+// 限流: 前 maxMessages 次 allow() 返回 true, 之后只计数
+class LogLimiter {
+public:
+    explicit LogLimiter(size_t maxMessages) : maxMessages(maxMessages) {}
+
+    bool allow() { return count.fetch_add(1, std::memory_order_relaxed) < maxMessages; }
+
+    size_t total() const { return count.load(std::memory_order_relaxed); }
+    size_t suppressed() const {
+        size_t n = total();
+        return n > maxMessages ? n - maxMessages : 0;
+    }
+
+private:
+    size_t maxMessages;
+    std::atomic<size_t> count{ 0 };
+};
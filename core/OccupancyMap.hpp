@@ -0,0 +1,107 @@
+#pragma once
+#include "bcf_structs.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// -------------------- 子区块占用位图 --------------------
+// 子区块 (144×376×144) 按 16³ 划分为 9×24×9 个格子, 每格 1 位表示格内是否有方块。
+// 写入时由区域包围盒计算, 存放在子区块目录中 (目录版本 4);
+// 读取端无需解码区域即可跳过空的格子或整个子区块。
+struct OccupancyMap {
+    static constexpr int CELL_SIZE = 16;
+    static constexpr int CELLS_X = 9;
+    static constexpr int CELLS_Y = 24;
+    static constexpr int CELLS_Z = 9;
+    static constexpr int CELL_COUNT = CELLS_X * CELLS_Y * CELLS_Z;
+    static constexpr int WORDS = (CELL_COUNT + 63) / 64;
+
+    std::array<uint64_t, WORDS> bits{};
+
+    static int cellIndex(int cx, int cy, int cz) {
+        return (cy * CELLS_Z + cz) * CELLS_X + cx;
+    }
+
+    bool test(int cx, int cy, int cz) const {
+        int i = cellIndex(cx, cy, cz);
+        return (bits[i >> 6] >> (i & 63)) & 1;
+    }
+
+    void set(int cx, int cy, int cz) {
+        int i = cellIndex(cx, cy, cz);
+        bits[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+
+    bool empty() const {
+        for (uint64_t w : bits) if (w) return false;
+        return true;
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        for (uint64_t w : bits) {
+            for (; w; w &= w - 1) n++;
+        }
+        return n;
+    }
+
+    // 标记区域 (子区块局部坐标) 覆盖的所有格子
+    void markRegion(const BlockRegion& r) {
+        int cx1, cy1, cz1, cx2, cy2, cz2;
+        cellRange(r.x1, r.y1, r.z1, r.x2, r.y2, r.z2, cx1, cy1, cz1, cx2, cy2, cz2);
+        for (int cy = cy1; cy <= cy2; cy++)
+            for (int cz = cz1; cz <= cz2; cz++)
+                for (int cx = cx1; cx <= cx2; cx++)
+                    set(cx, cy, cz);
+    }
+
+    // 局部坐标盒子内是否有被占用的格子 (可能多报, 不会漏报)
+    bool anyInBox(int x1, int y1, int z1, int x2, int y2, int z2) const {
+        int cx1, cy1, cz1, cx2, cy2, cz2;
+        cellRange(x1, y1, z1, x2, y2, z2, cx1, cy1, cz1, cx2, cy2, cz2);
+        for (int cy = cy1; cy <= cy2; cy++)
+            for (int cz = cz1; cz <= cz2; cz++)
+                for (int cx = cx1; cx <= cx2; cx++)
+                    if (test(cx, cy, cz)) return true;
+        return false;
+    }
+
+    // 依次回调每个被占用格子的局部坐标范围 [x1, x2] 等 (格子大小 16)
+    template<typename Fn>
+    void forEachOccupiedCell(Fn&& fn) const {
+        for (int cy = 0; cy < CELLS_Y; cy++)
+            for (int cz = 0; cz < CELLS_Z; cz++)
+                for (int cx = 0; cx < CELLS_X; cx++)
+                    if (test(cx, cy, cz)) {
+                        fn(cx * CELL_SIZE, cy * CELL_SIZE, cz * CELL_SIZE,
+                            cx * CELL_SIZE + CELL_SIZE - 1, cy * CELL_SIZE + CELL_SIZE - 1, cz * CELL_SIZE + CELL_SIZE - 1);
+                    }
+    }
+
+    static OccupancyMap build(const std::vector<BlockRegion>& regions) {
+        OccupancyMap map;
+        for (const auto& r : regions) map.markRegion(r);
+        return map;
+    }
+
+private:
+    // 局部坐标盒子换算为格子范围; 网格外的坐标归入最近的边缘格子,
+    // 所以超出 0..383 的区域也会被标记, 与之相交的查询盒子必然覆盖同一个边缘格子
+    static void cellRange(int x1, int y1, int z1, int x2, int y2, int z2,
+        int& cx1, int& cy1, int& cz1, int& cx2, int& cy2, int& cz2) {
+        if (x1 > x2) std::swap(x1, x2);
+        if (y1 > y2) std::swap(y1, y2);
+        if (z1 > z2) std::swap(z1, z2);
+        cx1 = cellOf(x1, CELLS_X);
+        cy1 = cellOf(y1, CELLS_Y);
+        cz1 = cellOf(z1, CELLS_Z);
+        cx2 = cellOf(x2, CELLS_X);
+        cy2 = cellOf(y2, CELLS_Y);
+        cz2 = cellOf(z2, CELLS_Z);
+    }
+
+    static int cellOf(int v, int cells) {
+        return v < 0 ? 0 : std::min(v / CELL_SIZE, cells - 1);
+    }
+};
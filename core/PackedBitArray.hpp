@@ -0,0 +1,221 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// -------------------- 紧凑位数组解码 --------------------
+// Minecraft 系格式把 palette 索引按固定位宽打包进 long 数组, 低位在前。两种排布:
+//   Spanning: 条目连续排列, 可以跨越两个 long (Litematica, 1.13~1.15 区块)
+//   Aligned:  每个 long 放 64 / bits 个条目, 不跨 long, 高位留空 (1.16+ 区块)
+// 长数组可分块 feed, 解码到调用方提供的 uint16_t 缓冲 (按行/按层复用), 不需要整个区域的索引数组。
+// 内层按位宽 (1~16) 实例化模板, 移位量全部是编译期常量; 定义 __AVX2__ 时 Spanning 每次并行解 4 个条目。
+enum class PackedLayout : uint8_t {
+    Spanning = 0,
+    Aligned = 1,
+};
+
+namespace PackedBitKernels {
+
+    // 块: Spanning 为 64 个条目 (正好 BITS 个 long), Aligned 为 1 个 long 内的 64 / BITS 个条目
+    template<int BITS>
+    struct Spanning {
+        static constexpr size_t ENTRIES = 64;
+        static constexpr size_t WORDS = BITS;
+        static constexpr uint64_t MASK = (uint64_t(1) << BITS) - 1;
+
+        template<size_t I>
+        static void entry(const uint64_t* w, uint16_t* out) {
+            constexpr size_t bit = I * BITS;
+            constexpr size_t wi = bit >> 6;
+            constexpr unsigned off = bit & 63;
+            uint64_t v = w[wi] >> off;
+            if constexpr (off + BITS > 64) v |= w[wi + 1] << (64 - off);
+            out[I] = static_cast<uint16_t>(v & MASK);
+        }
+
+        template<size_t... I>
+        static void block(const uint64_t* w, uint16_t* out, std::index_sequence<I...>) {
+            (entry<I>(w, out), ...);
+        }
+
+        static void decode(const uint64_t* words, uint16_t* out, size_t blocks) {
+            for (size_t b = 0; b < blocks; ++b)
+                block(words + b * WORDS, out + b * ENTRIES, std::make_index_sequence<ENTRIES>{});
+        }
+    };
+
+    template<int BITS>
+    struct Aligned {
+        static constexpr size_t ENTRIES = 64 / BITS;
+        static constexpr size_t WORDS = 1;
+        static constexpr uint64_t MASK = (uint64_t(1) << BITS) - 1;
+
+        template<size_t... I>
+        static void block(uint64_t w, uint16_t* out, std::index_sequence<I...>) {
+            ((out[I] = static_cast<uint16_t>((w >> (I * BITS)) & MASK)), ...);
+        }
+
+        static void decode(const uint64_t* words, uint16_t* out, size_t blocks) {
+            for (size_t b = 0; b < blocks; ++b)
+                block(words[b], out + b * ENTRIES, std::make_index_sequence<ENTRIES>{});
+        }
+    };
+
+#if defined(__AVX2__)
+    // 每个条目取其所在 long 与下一个 long, 4 路并行移位拼接 (左移 64 位结果为 0, 不跨 long 时自然忽略)。
+    // 块内最后一个条目会读块后的一个 long, 由解码器缓冲末尾的 0 保证可读。
+    template<int BITS>
+    struct SpanningAvx2 {
+        template<size_t I>
+        static __m256i quad(const uint64_t* w) {
+            constexpr size_t b0 = I * BITS, b1 = (I + 1) * BITS, b2 = (I + 2) * BITS, b3 = (I + 3) * BITS;
+            __m256i lo = _mm256_setr_epi64x(w[b0 >> 6], w[b1 >> 6], w[b2 >> 6], w[b3 >> 6]);
+            __m256i hi = _mm256_setr_epi64x(w[(b0 >> 6) + 1], w[(b1 >> 6) + 1], w[(b2 >> 6) + 1], w[(b3 >> 6) + 1]);
+            const __m256i sr = _mm256_setr_epi64x(b0 & 63, b1 & 63, b2 & 63, b3 & 63);
+            const __m256i sl = _mm256_setr_epi64x(64 - (b0 & 63), 64 - (b1 & 63), 64 - (b2 & 63), 64 - (b3 & 63));
+            __m256i v = _mm256_or_si256(_mm256_srlv_epi64(lo, sr), _mm256_sllv_epi64(hi, sl));
+            return _mm256_and_si256(v, _mm256_set1_epi64x((1LL << BITS) - 1));
+        }
+        // 16 个条目: 4 组 64 位结果压缩为 16 个 uint16_t
+        template<size_t G>
+        static void group(const uint64_t* w, uint16_t* o) {
+            const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            __m256i v0 = _mm256_permutevar8x32_epi32(quad<G>(w), even);
+            __m256i v1 = _mm256_permutevar8x32_epi32(quad<G + 4>(w), even);
+            __m256i v2 = _mm256_permutevar8x32_epi32(quad<G + 8>(w), even);
+            __m256i v3 = _mm256_permutevar8x32_epi32(quad<G + 12>(w), even);
+            __m256i a = _mm256_permute2x128_si256(v0, v1, 0x20);
+            __m256i c = _mm256_permute2x128_si256(v2, v3, 0x20);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(o + G), _mm256_permute4x64_epi64(_mm256_packus_epi32(a, c), 0xD8));
+        }
+        static void decode(const uint64_t* words, uint16_t* out, size_t blocks) {
+            for (size_t b = 0; b < blocks; ++b) {
+                const uint64_t* w = words + b * BITS;
+                uint16_t* o = out + b * 64;
+                group<0>(w, o); group<16>(w, o); group<32>(w, o); group<48>(w, o);
+            }
+        }
+    };
+#endif
+
+    using KernelFn = void(*)(const uint64_t*, uint16_t*, size_t);
+
+    template<int BITS>
+    KernelFn spanningKernel() {
+#if defined(__AVX2__)
+        return &SpanningAvx2<BITS>::decode;
+#else
+        return &Spanning<BITS>::decode;
+#endif
+    }
+
+    template<size_t... B>
+    KernelFn select(PackedLayout layout, int bits, std::index_sequence<B...>) {
+        KernelFn fn = nullptr;
+        ((bits == int(B) + 1
+            ? (fn = layout == PackedLayout::Spanning ? spanningKernel<int(B) + 1>() : &Aligned<int(B) + 1>::decode, 0)
+            : 0), ...);
+        return fn;
+    }
+}
+
+class PackedBitArrayDecoder {
+public:
+    static constexpr int MAX_BITS = 16;
+
+    explicit PackedBitArrayDecoder(int bitsPerEntry, PackedLayout layout = PackedLayout::Spanning)
+        : bits(bitsPerEntry), layout(layout) {
+        if (bits < 1 || bits > MAX_BITS) {
+            throw std::invalid_argument("Packed bit array entry width must be 1..16, got " + std::to_string(bits));
+        }
+        mask = (uint64_t(1) << bits) - 1;
+        entriesPerWord = 64 / bits;
+        blockEntries = layout == PackedLayout::Spanning ? 64 : entriesPerWord;
+        blockWords = layout == PackedLayout::Spanning ? static_cast<size_t>(bits) : 1;
+        kernel = PackedBitKernels::select(layout, bits, std::make_index_sequence<MAX_BITS>{});
+        words.assign(1, 0);
+    }
+
+    int bitsPerEntry() const { return bits; }
+
+    // 追加一段长数组; 已解码完的块会被丢弃, 缓冲只保留未消费部分
+    void feed(const int64_t* data, size_t count) {
+        compact();
+        size_t at = wordCount;
+        wordCount += count;
+        words.resize(wordCount + 1);          // 末尾保留一个 0, 供 AVX2 路径读取块后的 long
+        if (count) std::memcpy(words.data() + at, data, count * sizeof(uint64_t));
+        words[wordCount] = 0;
+    }
+
+    // 已 feed 的数据中还能完整解出的条目数
+    size_t available() const {
+        size_t total = layout == PackedLayout::Spanning
+            ? wordCount * 64 / static_cast<size_t>(bits)
+            : wordCount * entriesPerWord;
+        return total - pos;
+    }
+
+    // 解出最多 count 个条目, 返回实际个数 (受已 feed 的数据限制)
+    size_t decode(uint16_t* out, size_t count) {
+        size_t n = std::min(count, available());
+        size_t i = 0;
+        while (i < n && pos % blockEntries != 0) out[i++] = extract(pos++);
+
+        size_t blocks = (n - i) / blockEntries;
+        if (blocks) {
+            kernel(words.data() + (pos / blockEntries) * blockWords, out + i, blocks);
+            i += blocks * blockEntries;
+            pos += blocks * blockEntries;
+        }
+
+        while (i < n) out[i++] = extract(pos++);
+        return n;
+    }
+
+private:
+    uint16_t extract(size_t index) const {
+        uint64_t v;
+        if (layout == PackedLayout::Spanning) {
+            size_t bit = index * static_cast<size_t>(bits);
+            size_t wi = bit >> 6;
+            unsigned off = bit & 63;
+            v = words[wi] >> off;
+            if (off + bits > 64) v |= words[wi + 1] << (64 - off);
+        }
+        else {
+            v = words[index / entriesPerWord] >> ((index % entriesPerWord) * bits);
+        }
+        return static_cast<uint16_t>(v & mask);
+    }
+
+    // 丢弃已完全消费的块, 保持缓冲起点与块边界对齐
+    void compact() {
+        size_t doneBlocks = pos / blockEntries;
+        if (doneBlocks == 0) return;
+        size_t doneWords = doneBlocks * blockWords;
+        std::copy(words.begin() + doneWords, words.begin() + wordCount + 1, words.begin());
+        wordCount -= doneWords;
+        words.resize(wordCount + 1);
+        pos -= doneBlocks * blockEntries;
+    }
+
+    int bits;
+    PackedLayout layout;
+    uint64_t mask = 0;
+    size_t entriesPerWord = 0;
+    size_t blockEntries = 0;
+    size_t blockWords = 0;
+    PackedBitKernels::KernelFn kernel = nullptr;
+
+    std::vector<uint64_t> words;   // wordCount 个有效 long + 1 个 0
+    size_t wordCount = 0;
+    size_t pos = 0;                // 相对缓冲起点的下一个条目序号
+};
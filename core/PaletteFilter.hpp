@@ -0,0 +1,36 @@
+#pragma once
+#include "bcf_structs.hpp"
+#include <vector>
+
+// -------------------- PaletteID 位集 --------------------
+// 按方块类型/paletteId 过滤读取时使用, 每个 paletteId 占 1 bit
+struct PaletteFilter {
+    std::vector<uint64_t> bits;
+
+    PaletteFilter() = default;
+    explicit PaletteFilter(size_t paletteCount) : bits((paletteCount + 63) / 64, 0) {}
+
+    void set(PaletteID id) {
+        size_t word = id / 64;
+        if (word >= bits.size()) bits.resize(word + 1, 0);
+        bits[word] |= (1ULL << (id % 64));
+    }
+
+    bool test(PaletteID id) const {
+        size_t word = id / 64;
+        return word < bits.size() && (bits[word] >> (id % 64)) & 1ULL;
+    }
+
+    bool empty() const {
+        for (uint64_t w : bits) if (w) return false;
+        return true;
+    }
+
+    // 子区块使用的 paletteId 列表中是否有任意一个命中
+    bool matchesAny(const std::vector<PaletteID>& ids) const {
+        for (PaletteID id : ids) {
+            if (test(id)) return true;
+        }
+        return false;
+    }
+};
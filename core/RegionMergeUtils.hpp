@@ -5,6 +5,7 @@
 #include <vector>  
 #include <unordered_set>
 #include <unordered_map>
+#include <algorithm>
 
 
 
@@ -115,4 +116,51 @@ struct RegionMergeUtils {
 
         return regions;
     }
+
+    // 合并同 paletteId 且共享完整面的相邻长方体, 依次沿 X、Z、Y 方向各做一轮
+    // 每轮只需排序 + 线性扫描, 复杂度 O(n log n), 与区域内的方块数量无关
+    static std::vector<BlockRegion> coalesceRegions(std::vector<BlockRegion> regions) {
+        coalesceAlongAxis(regions, 0);
+        coalesceAlongAxis(regions, 2);
+        coalesceAlongAxis(regions, 1);
+        return regions;
+    }
+
+private:
+    // axis: 0 = X, 1 = Y, 2 = Z
+    static void coalesceAlongAxis(std::vector<BlockRegion>& regions, int axis) {
+        if (regions.size() < 2) return;
+
+        auto lo = [axis](const BlockRegion& r) { return axis == 0 ? r.x1 : axis == 1 ? r.y1 : r.z1; };
+        auto hi = [axis](const BlockRegion& r) { return axis == 0 ? r.x2 : axis == 1 ? r.y2 : r.z2; };
+        // 另外两个轴上的范围, 相同才可以沿 axis 拼接
+        auto face = [axis](const BlockRegion& r) {
+            return axis == 0 ? std::make_tuple(r.y1, r.y2, r.z1, r.z2)
+                : axis == 1 ? std::make_tuple(r.x1, r.x2, r.z1, r.z2)
+                : std::make_tuple(r.x1, r.x2, r.y1, r.y2);
+        };
+
+        std::sort(regions.begin(), regions.end(), [&](const BlockRegion& a, const BlockRegion& b) {
+            if (a.paletteId != b.paletteId) return a.paletteId < b.paletteId;
+            auto fa = face(a), fb = face(b);
+            if (fa != fb) return fa < fb;
+            return lo(a) < lo(b);
+        });
+
+        size_t out = 0;
+        for (size_t i = 1; i < regions.size(); i++) {
+            BlockRegion& cur = regions[out];
+            const BlockRegion& next = regions[i];
+            if (cur.paletteId == next.paletteId && face(cur) == face(next)
+                && hi(cur) + 1 == lo(next)) {
+                if (axis == 0) cur.x2 = next.x2;
+                else if (axis == 1) cur.y2 = next.y2;
+                else cur.z2 = next.z2;
+            }
+            else {
+                regions[++out] = next;
+            }
+        }
+        regions.resize(out + 1);
+    }
 };
\ No newline at end of file
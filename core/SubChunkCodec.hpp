@@ -0,0 +1,124 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+// -------------------- 子区块负载压缩 --------------------
+// v5 起每个子区块头带一个 codec 字节: 低 4 位为压缩算法, 高 4 位为区域布局。
+// 压缩算法: 0 = 不压缩, 1 = zlib; 2~15 留给自定义算法, 通过 registerCodec 注册。
+enum SubChunkCodecID : uint8_t {
+    CODEC_NONE = 0,
+    CODEC_ZLIB = 1,
+};
+
+// 区域布局: 0 = 16 字节定长记录, 1 = 列式增量编码 (见 ColumnarRegionCodec)
+enum SubChunkLayoutID : uint8_t {
+    LAYOUT_ROWS = 0,
+    LAYOUT_COLUMNAR = 1,
+};
+
+inline uint8_t makeCodecByte(uint8_t compression, uint8_t layout) {
+    return static_cast<uint8_t>((layout << 4) | (compression & 0x0F));
+}
+inline uint8_t codecCompression(uint8_t codecByte) { return codecByte & 0x0F; }
+inline uint8_t codecLayout(uint8_t codecByte) { return codecByte >> 4; }
+
+struct SubChunkCodec {
+    // 压缩: 输入原始字节, 输出压缩后字节
+    using CompressFn = std::function<std::vector<char>(const char* data, size_t size)>;
+    // 解压: 原始大小已知, 解压到 out[0, rawSize)
+    using DecompressFn = std::function<void(const char* data, size_t size, char* out, size_t rawSize)>;
+
+    struct Codec {
+        CompressFn compress;
+        DecompressFn decompress;
+        // 解压后大小 / 负载大小的上限, 读取时据此在分配前拒绝损坏的区域数 (zlib 理论上限约 1032:1)
+        size_t maxRatio = 1032;
+    };
+
+    static constexpr size_t MAX_CODECS = 16;
+
+    // 自定义算法须在任何读写开始前注册: 首次 get 之后注册表冻结, 之后只读,
+    // 可被 std::async 工作线程无锁并发访问; 冻结后再注册抛出 logic_error
+    static void registerCodec(uint8_t id, Codec codec) {
+        if (id >= MAX_CODECS) throw std::out_of_range("Sub-chunk codec id must be < 16");
+        std::lock_guard<std::mutex> lock(registryMutex());
+        if (frozen().load(std::memory_order_relaxed)) {
+            throw std::logic_error("Sub-chunk codecs must be registered before first use");
+        }
+        table()[id] = std::move(codec);
+    }
+
+    static const Codec& get(uint8_t id) {
+        if (id >= MAX_CODECS) {
+            throw std::runtime_error("Unsupported sub-chunk codec: " + std::to_string(id));
+        }
+        if (!frozen().load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            frozen().store(true, std::memory_order_release);
+        }
+        const Codec& codec = table()[id];
+        if (!codec.compress || !codec.decompress) {
+            throw std::runtime_error("Unsupported sub-chunk codec: " + std::to_string(id));
+        }
+        return codec;
+    }
+
+private:
+    static std::array<Codec, MAX_CODECS>& table() {
+        static std::array<Codec, MAX_CODECS> codecs = builtinCodecs();
+        return codecs;
+    }
+
+    static std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::atomic<bool>& frozen() {
+        static std::atomic<bool> flag{ false };
+        return flag;
+    }
+
+    static std::array<Codec, MAX_CODECS> builtinCodecs() {
+        std::array<Codec, MAX_CODECS> codecs;
+
+        codecs[CODEC_NONE] = {
+            [](const char* data, size_t size) { return std::vector<char>(data, data + size); },
+            [](const char* data, size_t size, char* out, size_t rawSize) {
+                if (size != rawSize) throw std::runtime_error("Sub-chunk payload size mismatch");
+                std::copy(data, data + size, out);
+            },
+            1
+        };
+
+        codecs[CODEC_ZLIB] = {
+            [](const char* data, size_t size) {
+                uLongf bound = compressBound(static_cast<uLong>(size));
+                std::vector<char> out(bound);
+                int ret = compress2(reinterpret_cast<Bytef*>(out.data()), &bound,
+                    reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size), Z_DEFAULT_COMPRESSION);
+                if (ret != Z_OK) throw std::runtime_error("zlib compress failed");
+                out.resize(bound);
+                return out;
+            },
+            [](const char* data, size_t size, char* out, size_t rawSize) {
+                uLongf outLen = static_cast<uLongf>(rawSize);
+                int ret = uncompress(reinterpret_cast<Bytef*>(out), &outLen,
+                    reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size));
+                if (ret != Z_OK || outLen != rawSize) {
+                    throw std::runtime_error("zlib decompress failed");
+                }
+            }
+        };
+
+        return codecs;
+    }
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include "bcf_structs.hpp"
+#include "bcf_io.hpp"
+#include "ByteSink.hpp"
+#include "ByteCursor.hpp"
+#include "OccupancyMap.hpp"
+#include <fstream>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+// -------------------- 子区块目录 --------------------
+// 目录紧跟在子区块偏移量表之后、palette 之前写入:
+//   char magic[3] = "SCD" | u8 目录版本 | u64 条目数 | SubChunkDirEntry[条目数]
+//   版本 2 起追加: 每个子区块使用的 paletteId 列表 (升序, 个数为 paletteUsedCount, u32 each)
+//   版本 3 起追加: 每个子区块 (从 subChunkSize 字段开始的全部字节) 的 CRC32, u32 each
+//   版本 4 起追加: 每个子区块的 16³ 占用位图 (OccupancyMap::WORDS 个 u64)
+// 旧版读取器按 paletteOffset 直接跳转, 不会读到这段数据, 因此 v4 文件格式保持兼容。
+struct SubChunkDirectory {
+    static constexpr char MAGIC[3] = { 'S', 'C', 'D' };
+    static constexpr uint8_t VERSION = 4;
+
+    // 根据合并后的区域统计目录条目 (offset / subChunkSize 由调用方在写入后填写)
+    // usedIds 非空时输出升序去重后的 paletteId 列表
+    static SubChunkDirEntry summarize(const std::vector<BlockRegion>& regions,
+        Coord originX, Coord originY, Coord originZ,
+        std::vector<PaletteID>* usedIds = nullptr) {
+        SubChunkDirEntry entry;
+        entry.originX = originX;
+        entry.originY = originY;
+        entry.originZ = originZ;
+        entry.blockRegionCount = static_cast<BlockCount>(regions.size());
+
+        if (usedIds) usedIds->clear();
+        if (regions.empty()) return entry;
+
+        entry.minX = entry.minY = entry.minZ = std::numeric_limits<Coord>::max();
+        entry.maxX = entry.maxY = entry.maxZ = std::numeric_limits<Coord>::min();
+        entry.minPaletteId = std::numeric_limits<PaletteID>::max();
+        entry.maxPaletteId = 0;
+
+        std::vector<PaletteID> ids;
+        ids.reserve(regions.size());
+        for (const auto& r : regions) {
+            entry.minX = std::min(entry.minX, r.x1);
+            entry.minY = std::min(entry.minY, r.y1);
+            entry.minZ = std::min(entry.minZ, r.z1);
+            entry.maxX = std::max(entry.maxX, r.x2);
+            entry.maxY = std::max(entry.maxY, r.y2);
+            entry.maxZ = std::max(entry.maxZ, r.z2);
+            entry.blockCount += static_cast<uint64_t>(r.x2 - r.x1 + 1)
+                * static_cast<uint64_t>(r.y2 - r.y1 + 1)
+                * static_cast<uint64_t>(r.z2 - r.z1 + 1);
+            entry.minPaletteId = std::min(entry.minPaletteId, r.paletteId);
+            entry.maxPaletteId = std::max(entry.maxPaletteId, r.paletteId);
+            ids.push_back(r.paletteId);
+        }
+
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        entry.paletteUsedCount = static_cast<PaletteID>(ids.size());
+        if (usedIds) *usedIds = std::move(ids);
+        return entry;
+    }
+
+    static void write(ByteSink& out, const std::vector<SubChunkDirEntry>& entries,
+        const std::vector<std::vector<PaletteID>>& paletteIds,
+        const std::vector<uint32_t>& checksums,
+        const std::vector<OccupancyMap>& occupancy) {
+        out.bytes(MAGIC, sizeof(MAGIC));
+        out.u8(VERSION);
+        out.u64(entries.size());
+        out.bytes(entries.data(), entries.size() * sizeof(SubChunkDirEntry));
+        for (const auto& ids : paletteIds) {
+            out.bytes(ids.data(), ids.size() * sizeof(PaletteID));
+        }
+        out.bytes(checksums.data(), checksums.size() * sizeof(uint32_t));
+        for (const auto& map : occupancy) {
+            out.bytes(map.bits.data(), sizeof(map.bits));
+        }
+    }
+
+    // 尝试从游标当前位置读取目录 (游标的剩余部分即目录所在区段); 不存在 (旧文件) 时返回 false
+    // 旧版本目录缺少的部分 (paletteId 列表 / 校验和 / 占用位图) 对应的输出保持为空
+    static bool tryRead(ByteCursor& in, FilePos expectedCount,
+        std::vector<SubChunkDirEntry>& entries,
+        std::vector<std::vector<PaletteID>>& paletteIds,
+        std::vector<uint32_t>& checksums,
+        std::vector<OccupancyMap>& occupancy) {
+        if (in.remaining() < sizeof(MAGIC) + 1 + sizeof(uint64_t)) return false;
+
+        const char* magic = in.take(sizeof(MAGIC));
+        if (!std::equal(magic, magic + 3, MAGIC)) return false;
+
+        uint8_t version = in.u8();
+        if (version == 0 || version > VERSION) return false;
+
+        uint64_t count = in.u64();
+        if (count != expectedCount) return false;
+        if (count > in.remaining() / sizeof(SubChunkDirEntry)) return false;
+
+        entries.resize(count);
+        in.bytes(entries.data(), count * sizeof(SubChunkDirEntry));
+
+        paletteIds.clear();
+        if (version >= 2) {
+            paletteIds.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                size_t n = entries[i].paletteUsedCount;
+                if (n > in.remaining() / sizeof(PaletteID)) return false;
+                paletteIds[i].resize(n);
+                in.bytes(paletteIds[i].data(), n * sizeof(PaletteID));
+            }
+        }
+
+        checksums.clear();
+        if (version >= 3) {
+            if (count > in.remaining() / sizeof(uint32_t)) return false;
+            checksums.resize(count);
+            in.bytes(checksums.data(), count * sizeof(uint32_t));
+        }
+
+        occupancy.clear();
+        if (version >= 4) {
+            if (count > in.remaining() / sizeof(OccupancyMap::bits)) return false;
+            occupancy.resize(count);
+            for (auto& map : occupancy) {
+                in.bytes(map.bits.data(), sizeof(map.bits));
+            }
+        }
+        return true;
+    }
+
+    // 子区块包围盒 (世界坐标) 是否与给定的盒子相交
+    static bool intersects(const SubChunkDirEntry& e,
+        int x1, int y1, int z1, int x2, int y2, int z2) {
+        if (e.blockRegionCount == 0) return false;
+        return e.originX + e.minX <= x2 && e.originX + e.maxX >= x1
+            && e.originY + e.minY <= y2 && e.originY + e.maxY >= y1
+            && e.originZ + e.minZ <= z2 && e.originZ + e.maxZ >= z1;
+    }
+};
@@ -1,60 +1,218 @@
 #pragma once
 #include "BlockUtils.hpp"
+#include "PaletteFilter.hpp"
+#include "SubChunkCodec.hpp"
+#include "ColumnarRegionCodec.hpp"
+#include "Checksum.hpp"
 
 
 struct SubChunkUtils {
 
-    // д
-    static void writeSubChunk(std::ofstream& ofs,
+    // 写入子区块
+    static void writeSubChunk(ByteSink& out,
         const std::vector<BlockRegion>& regions,
-        Coord originX, Coord originY, Coord originZ) {  //  originX  originZ   
-        std::streampos startPos = ofs.tellp();
-        write_u64(ofs, 0); // ռλ subChunkSize    
-        write_i16(ofs, originX);  // д X   
-        write_i16(ofs, originY);  // д Y   
-        write_i16(ofs, originZ);  // д Z   
-        write_u32(ofs, regions.size());
+        Coord originX, Coord originY, Coord originZ) {  // 添加 originX 和 originZ 参数  
+        FilePos startPos = out.tell();
+        out.u64(0); // 占位 subChunkSize    
+        out.i16(originX);  // 写入 X 坐标  
+        out.i16(originY);  // 写入 Y 坐标  
+        out.i16(originZ);  // 写入 Z 坐标  
+        out.u32(static_cast<BlockCount>(regions.size()));
 
         for (const auto& region : regions) {
-            write_u32(ofs, region.paletteId);
-            write_i16(ofs, region.x1);
-            write_i16(ofs, region.y1);
-            write_i16(ofs, region.z1);
-            write_i16(ofs, region.x2);
-            write_i16(ofs, region.y2);
-            write_i16(ofs, region.z2);
+            out.u32(region.paletteId);
+            out.i16(region.x1);
+            out.i16(region.y1);
+            out.i16(region.z1);
+            out.i16(region.x2);
+            out.i16(region.y2);
+            out.i16(region.z2);
         }
 
-        std::streampos endPos = ofs.tellp();
-        ofs.seekp(startPos);
-        write_u64(ofs, static_cast<SubChunkSize>(endPos - startPos));
-        ofs.seekp(endPos);
+        out.patch<SubChunkSize>(startPos, out.tell() - startPos);
     }
-    // ļȡ
-    static std::vector<BlockRegion> readSubChunk(std::ifstream& ifs,
+    // v5: 写入压缩后的子区块
+    // 布局: u64 subChunkSize | i16 originX/Y/Z | u32 regionCount | u8 codec | u32 payloadSize
+    //       | [u32 rawSize, 仅列式布局] | payload
+    // 行布局的 payload 解压后为 regionCount 条 16 字节区域记录, 与 v4 的区域记录格式相同;
+    // 列式布局解压后为 ColumnarRegionCodec 编码的数据
+    static void writeSubChunkCompressed(ByteSink& out,
+        const std::vector<BlockRegion>& regions,
+        Coord originX, Coord originY, Coord originZ,
+        uint8_t codec) {
+        const bool columnar = codecLayout(codec) == LAYOUT_COLUMNAR;
+        std::vector<char> raw;
+        if (columnar) {
+            raw = ColumnarRegionCodec::encode(regions);
+        }
+        else {
+            const char* begin = reinterpret_cast<const char*>(regions.data());
+            raw.assign(begin, begin + regions.size() * sizeof(BlockRegion));
+        }
+        std::vector<char> payload = SubChunkCodec::get(codecCompression(codec)).compress(raw.data(), raw.size());
+
+        SubChunkSize subChunkSize = sizeof(SubChunkSize) + 3 * sizeof(Coord) + sizeof(BlockCount)
+            + sizeof(uint8_t) + sizeof(uint32_t) + (columnar ? sizeof(uint32_t) : 0) + payload.size();
+        out.u64(subChunkSize);
+        out.i16(originX);
+        out.i16(originY);
+        out.i16(originZ);
+        out.u32(static_cast<BlockCount>(regions.size()));
+        out.u8(codec);
+        out.u32(static_cast<uint32_t>(payload.size()));
+        if (columnar) out.u32(static_cast<uint32_t>(raw.size()));
+        out.bytes(payload.data(), payload.size());
+    }
+
+    // 按文件版本读取子区块 (v4 原始记录 / v5 压缩负载)
+    // 先按 subChunkSize 把整个子区块读入内存, 再用 ByteCursor 解码
+    // expectedCrc 非空时先校验整个子区块 (含 subChunkSize 字段) 的 CRC32
+    static std::vector<BlockRegion> readSubChunk(std::ifstream& ifs, Version version,
         SubChunkSize& subChunkSize,
-        Coord& originX, Coord& originY, Coord& originZ) {  //  originX  originZ   
+        Coord& originX, Coord& originY, Coord& originZ,
+        const uint32_t* expectedCrc = nullptr) {
+        std::vector<char> buffer = readSubChunkBuffer(ifs, subChunkSize, expectedCrc);
+        ByteCursor in(buffer);
+        return readSubChunkBody(in, version, originX, originY, originZ);
+    }
+
+    // 读入 subChunkSize 之后的整个子区块并校验 CRC
+    static std::vector<char> readSubChunkBuffer(std::ifstream& ifs, SubChunkSize& subChunkSize,
+        const uint32_t* expectedCrc) {
         subChunkSize = read_u64(ifs);
-        originX = read_i16(ifs);  // ȡ X   
-        originY = read_i16(ifs);  // ȡ Y   
-        originZ = read_i16(ifs);  // ȡ Z   
-        BlockCount regionCount = read_u32(ifs);
+        if (!ifs || subChunkSize < sizeof(SubChunkSize)) {
+            throw std::runtime_error("Invalid sub-chunk size");
+        }
+        std::vector<char> buffer(subChunkSize - sizeof(SubChunkSize));
+        if (!buffer.empty()) ifs.read(buffer.data(), buffer.size());
+        if (!ifs) {
+            throw std::runtime_error("Truncated sub-chunk");
+        }
+        if (expectedCrc) {
+            uint32_t crc = Checksum::update(Checksum::compute(&subChunkSize, sizeof(subChunkSize)),
+                buffer.data(), buffer.size());
+            if (crc != *expectedCrc) {
+                throw std::runtime_error("Sub-chunk checksum mismatch");
+            }
+        }
+        return buffer;
+    }
 
-        std::vector<BlockRegion> regions;
-        regions.reserve(regionCount);
+    // 解码 subChunkSize 之后的子区块内容
+    static std::vector<BlockRegion> readSubChunkBody(ByteCursor& in, Version version,
+        Coord& originX, Coord& originY, Coord& originZ) {
+        BlockCount regionCount = readSubChunkHeader(in, originX, originY, originZ);
+        return readRegionRecords(in, version, regionCount);
+    }
+
+    // 子区块头: 原点 + 区域数
+    static BlockCount readSubChunkHeader(ByteCursor& in, Coord& originX, Coord& originY, Coord& originZ) {
+        in.require(3 * sizeof(Coord) + sizeof(BlockCount));
+        originX = in.getUnchecked<Coord>();
+        originY = in.getUnchecked<Coord>();
+        originZ = in.getUnchecked<Coord>();
+        return in.getUnchecked<BlockCount>();
+    }
+
+    // 一个子区块最多容纳的方块数 (X/Z 各 144, 局部 Y 为非负的 Coord); 区域互不重叠, 区域数不会更多
+    static constexpr uint64_t SUBCHUNK_VOLUME = 144ull * 144 * 32768;
+
+    // v5 负载头: u8 codec | u32 payloadSize | [u32 rawSize, 仅列式布局] | payload
+    struct PayloadView {
+        uint8_t codec = 0;
+        bool columnar = false;
+        const char* payload = nullptr;
+        uint32_t payloadSize = 0;
+        size_t rawSize = 0;         // 解压后的字节数
+    };
 
+    // 解析负载头, 在任何按文件中的计数分配内存之前检查:
+    // regionCount 不超过 SUBCHUNK_VOLUME, 列式布局每个区域至少 6 字节,
+    // 解压后大小不超过 payloadSize * 压缩算法的最大压缩比 (zlib 为 1032)
+    static PayloadView readPayloadHeader(ByteCursor& in, BlockCount regionCount) {
+        if (regionCount > SUBCHUNK_VOLUME) {
+            throw std::runtime_error("Region count exceeds sub-chunk volume");
+        }
+        PayloadView view;
+        in.require(sizeof(uint8_t) + sizeof(uint32_t));
+        view.codec = in.getUnchecked<uint8_t>();
+        view.payloadSize = in.getUnchecked<uint32_t>();
+        view.columnar = codecLayout(view.codec) == LAYOUT_COLUMNAR;
+        view.rawSize = view.columnar ? in.u32() : sizeof(BlockRegion) * static_cast<size_t>(regionCount);
+        // 负载直接在缓冲中解压, 不再复制
+        view.payload = in.take(view.payloadSize);
+
+        const auto& codec = SubChunkCodec::get(codecCompression(view.codec));
+        if (view.columnar && static_cast<uint64_t>(regionCount) * 6 > view.rawSize) {
+            throw std::runtime_error("Region count exceeds columnar payload");
+        }
+        if (static_cast<uint64_t>(view.rawSize) > static_cast<uint64_t>(view.payloadSize) * codec.maxRatio) {
+            throw std::runtime_error("Region count does not match sub-chunk payload");
+        }
+        return view;
+    }
+
+    // 只读取 paletteId 命中过滤器的区域: 先检查每条记录的 paletteId 再复制,
+    // 列式布局先展开 paletteId 列, 未命中的区域不解码坐标
+    static std::vector<BlockRegion> readSubChunkFiltered(std::ifstream& ifs, Version version,
+        SubChunkSize& subChunkSize,
+        Coord& originX, Coord& originY, Coord& originZ,
+        const PaletteFilter& filter, const uint32_t* expectedCrc = nullptr) {
+        std::vector<char> buffer = readSubChunkBuffer(ifs, subChunkSize, expectedCrc);
+        ByteCursor in(buffer);
+        BlockCount regionCount = readSubChunkHeader(in, originX, originY, originZ);
+        if (version < 5) {
+            return filterRecords(in.take(sizeof(BlockRegion) * static_cast<size_t>(regionCount)), regionCount, filter);
+        }
+
+        PayloadView view = readPayloadHeader(in, regionCount);
+        std::vector<char> raw(view.rawSize);
+        SubChunkCodec::get(codecCompression(view.codec)).decompress(view.payload, view.payloadSize, raw.data(), raw.size());
+        if (view.columnar) {
+            return ColumnarRegionCodec::decodeFiltered(raw.data(), raw.size(), regionCount, filter);
+        }
+        return filterRecords(raw.data(), regionCount, filter);
+    }
+
+    // 逐条检查行布局区域记录的 paletteId (记录首字段), 只复制命中的记录
+    static std::vector<BlockRegion> filterRecords(const char* records, BlockCount regionCount,
+        const PaletteFilter& filter) {
+        std::vector<BlockRegion> regions;
         for (size_t i = 0; i < regionCount; i++) {
-            BlockRegion region;
-            region.paletteId = read_u32(ifs);
-            region.x1 = read_i16(ifs);
-            region.y1 = read_i16(ifs);
-            region.z1 = read_i16(ifs);
-            region.x2 = read_i16(ifs);
-            region.y2 = read_i16(ifs);
-            region.z2 = read_i16(ifs);
-            regions.push_back(region);
+            const char* record = records + i * sizeof(BlockRegion);
+            PaletteID id;
+            std::memcpy(&id, record, sizeof(id));
+            if (!filter.test(id)) continue;
+            regions.emplace_back();
+            std::memcpy(&regions.back(), record, sizeof(BlockRegion));
+        }
+        return regions;
+    }
+
+    // 读取子区块头之后的全部区域记录
+    // 区域记录与 BlockRegion 的内存布局一致 (pack(1), 小端), 整块复制
+    // regionCount 来自文件, 分配前先由 readPayloadHeader 用负载大小约束 (v4 由缓冲长度约束)
+    static std::vector<BlockRegion> readRegionRecords(ByteCursor& in, Version version,
+        BlockCount regionCount) {
+        const size_t rawSize = sizeof(BlockRegion) * static_cast<size_t>(regionCount);
+        if (version < 5) {
+            const char* records = in.take(rawSize);
+            std::vector<BlockRegion> regions(regionCount);
+            if (rawSize) std::memcpy(regions.data(), records, rawSize);
+            return regions;
+        }
+
+        PayloadView view = readPayloadHeader(in, regionCount);
+        const auto& decompressor = SubChunkCodec::get(codecCompression(view.codec));
+        if (view.columnar) {
+            std::vector<char> raw(view.rawSize);
+            decompressor.decompress(view.payload, view.payloadSize, raw.data(), raw.size());
+            return ColumnarRegionCodec::decode(raw.data(), raw.size(), regionCount);
         }
 
+        std::vector<BlockRegion> regions(regionCount);
+        decompressor.decompress(view.payload, view.payloadSize,
+            reinterpret_cast<char*>(regions.data()), rawSize);
         return regions;
     }
     static PaletteID getPaletteId(
@@ -71,6 +229,6 @@ struct SubChunkUtils {
             }
         }
 
-        return static_cast<PaletteID>(-1); // δҵ,  or δ洢
+        return static_cast<PaletteID>(-1); // 未找到, 空气 or 未存储
     }
 };
@@ -0,0 +1,122 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <iconv.h>
+#include <cerrno>
+#endif
+
+// -------------------- 文本编码 --------------------
+// 旧版结构文件和命令中可能混有 GBK 字符串, 写入 BCF 前统一转成 UTF-8。
+// Windows 使用系统代码页 936, 其他平台使用 iconv。
+
+inline bool is_valid_utf8(const std::string& s) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(s.data());
+    size_t len = s.size();
+
+    for (size_t i = 0; i < len; ) {
+        unsigned char c = bytes[i];
+
+        // 1-byte (0xxxxxxx)
+        if (c <= 0x7F) {
+            i += 1;
+        }
+        // 2-byte (110xxxxx 10xxxxxx)
+        else if ((c >> 5) == 0x6) {
+            if (i + 1 >= len) return false;
+            if ((bytes[i + 1] >> 6) != 0x2) return false;
+            i += 2;
+        }
+        // 3-byte (1110xxxx 10xxxxxx 10xxxxxx)
+        else if ((c >> 4) == 0xE) {
+            if (i + 2 >= len) return false;
+            if ((bytes[i + 1] >> 6) != 0x2) return false;
+            if ((bytes[i + 2] >> 6) != 0x2) return false;
+            i += 3;
+        }
+        // 4-byte (11110xxx 10xxxxxx 10xxxxxx 10xxxxxx)
+        else if ((c >> 3) == 0x1E) {
+            if (i + 3 >= len) return false;
+            if ((bytes[i + 1] >> 6) != 0x2) return false;
+            if ((bytes[i + 2] >> 6) != 0x2) return false;
+            if ((bytes[i + 3] >> 6) != 0x2) return false;
+            i += 4;
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef _WIN32
+inline std::string gbk_to_utf8(const std::string& gbk) {
+    if (gbk.empty()) return {};
+
+    // GBK -> UTF-16
+    int wlen = MultiByteToWideChar(936, 0, gbk.data(), (int)gbk.size(), nullptr, 0);
+    if (wlen <= 0) return {};
+
+    std::wstring wstr(wlen, 0);
+    MultiByteToWideChar(936, 0, gbk.data(), (int)gbk.size(), &wstr[0], wlen);
+
+    // UTF-16 -> UTF-8
+    int u8len = WideCharToMultiByte(CP_UTF8, 0, wstr.data(), wlen, nullptr, 0, nullptr, nullptr);
+    if (u8len <= 0) return {};
+
+    std::string u8(u8len, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wstr.data(), wlen, &u8[0], u8len, nullptr, nullptr);
+
+    return u8;
+}
+#else
+inline std::string gbk_to_utf8(const std::string& gbk) {
+    if (gbk.empty()) return {};
+
+    iconv_t cd = iconv_open("UTF-8", "GBK");
+    if (cd == reinterpret_cast<iconv_t>(-1)) cd = iconv_open("UTF-8", "CP936");
+    if (cd == reinterpret_cast<iconv_t>(-1)) {
+        // 没有 GBK 转换表时不能静默返回空串 (路径、方块名会变成空字符串)
+        throw std::runtime_error("iconv does not support GBK -> UTF-8 conversion");
+    }
+
+    std::string u8;
+    u8.reserve(gbk.size() * 3 / 2 + 4);
+    char* in = const_cast<char*>(gbk.data());
+    size_t inLeft = gbk.size();
+    char buf[256];
+
+    while (inLeft > 0) {
+        char* out = buf;
+        size_t outLeft = sizeof(buf);
+        size_t ret = iconv(cd, &in, &inLeft, &out, &outLeft);
+        u8.append(buf, out - buf);
+        if (ret != static_cast<size_t>(-1)) break;
+
+        if (errno == E2BIG) continue;
+        // 非法或截断的字节替换为 U+FFFD 后继续, 与 MultiByteToWideChar 默认行为相近
+        u8.append("\xEF\xBF\xBD");
+        in++;
+        inLeft--;
+    }
+
+    iconv_close(cd);
+    return u8;
+}
+#endif
+
+inline std::string ensure_utf8(const std::string& s) {
+    if (s.empty()) return s;
+
+    if (is_valid_utf8(s)) {
+        return s;              // 已经是 UTF-8
+    }
+
+    return gbk_to_utf8(s);     // 不是 → 当 GBK 转
+}
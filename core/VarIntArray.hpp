@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// -------------------- 变长整数数组解码 --------------------
+// Sponge schem 的 BlockData 把 palette 索引按 LEB128 varint 顺序存放 (每字节低 7 位, 最高位为续位)。
+// 与 PackedBitArrayDecoder 相同的用法: 字节数组分块 feed, 按行解码到调用方的缓冲,
+// 一个 varint 跨越两次 feed 时保留在缓冲中等下一块。
+// palette 不超过 128 项时所有索引都是单字节: 每次检查 8 个字节的续位, 全为 0 时直接展宽写出,
+// 只有遇到多字节索引才逐个解码。
+class VarIntArrayDecoder {
+public:
+    static constexpr int MAX_BYTES = 5;   // 32 位索引最多 5 个字节
+
+    // 追加一段字节数组; 已解码的字节会被丢弃, 缓冲只保留未消费部分
+    void feed(const int8_t* data, size_t count) {
+        compact();
+        size_t at = bytes.size();
+        bytes.resize(at + count);
+        if (count) std::memcpy(bytes.data() + at, data, count);
+    }
+
+    // 缓冲中还没被解码的字节数 (末尾可能是不完整的 varint)
+    size_t pending() const { return bytes.size() - pos; }
+
+    // 解出最多 count 个完整的 varint, 返回实际个数; 剩下的不完整 varint 等下一次 feed
+    size_t decode(uint32_t* out, size_t count) {
+        const uint8_t* p = bytes.data();
+        const size_t size = bytes.size();
+        size_t i = 0;
+        while (i < count) {
+            // 快速路径: 8 个单字节索引
+            if (count - i >= 8 && size - pos >= 8) {
+                uint64_t w;
+                std::memcpy(&w, p + pos, sizeof(w));
+                if ((w & 0x8080808080808080ull) == 0) {
+                    for (int k = 0; k < 8; ++k) out[i + k] = p[pos + k];
+                    i += 8;
+                    pos += 8;
+                    continue;
+                }
+            }
+            if (pos >= size) break;
+            if (p[pos] < 0x80) {
+                out[i++] = p[pos++];
+                continue;
+            }
+
+            uint32_t value = 0;
+            size_t at = pos;
+            int n = 0;
+            uint8_t byte;
+            do {
+                if (at >= size) return i;     // 不完整, 等待更多数据
+                if (n == MAX_BYTES) throw std::runtime_error("VarInt in block data is too long");
+                byte = p[at++];
+                value |= static_cast<uint32_t>(byte & 0x7F) << (7 * n);
+                ++n;
+            } while (byte & 0x80);
+            out[i++] = value;
+            pos = at;
+        }
+        return i;
+    }
+
+private:
+    void compact() {
+        if (pos == 0) return;
+        bytes.erase(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(pos));
+        pos = 0;
+    }
+
+    std::vector<uint8_t> bytes;
+    size_t pos = 0;
+};
@@ -1,9 +1,15 @@
 #pragma once
+#include <filesystem>
 #include <fstream>
 #include <string>
+#include <stdexcept>
 #include "bcf_structs.hpp"
-#define NOMINMAX
-#include <windows.h>
+#include "TextEncoding.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 // -------------------- Endian-safe helpers --------------------
 template<typename T> void write_le(std::ofstream& ofs, T v) { ofs.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
@@ -21,85 +27,26 @@ inline uint32_t read_u32(std::ifstream& ifs) { uint32_t v; read_le(ifs, v); retu
 inline uint64_t read_u64(std::ifstream& ifs) { uint64_t v; read_le(ifs, v); return v; }
 inline int16_t  read_i16(std::ifstream& ifs) { int16_t v; read_le(ifs, v); return v; }
 
-
-
-
-
-
-inline bool is_valid_utf8(const std::string& s) {
-    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(s.data());
-    size_t len = s.size();
-
-    for (size_t i = 0; i < len; ) {
-        unsigned char c = bytes[i];
-
-        // 1-byte (0xxxxxxx)
-        if (c <= 0x7F) {
-            i += 1;
-        }
-        // 2-byte (110xxxxx 10xxxxxx)
-        else if ((c >> 5) == 0x6) {
-            if (i + 1 >= len) return false;
-            if ((bytes[i + 1] >> 6) != 0x2) return false;
-            i += 2;
-        }
-        // 3-byte (1110xxxx 10xxxxxx 10xxxxxx)
-        else if ((c >> 4) == 0xE) {
-            if (i + 2 >= len) return false;
-            if ((bytes[i + 1] >> 6) != 0x2) return false;
-            if ((bytes[i + 2] >> 6) != 0x2) return false;
-            i += 3;
-        }
-        // 4-byte (11110xxx 10xxxxxx 10xxxxxx 10xxxxxx)
-        else if ((c >> 3) == 0x1E) {
-            if (i + 3 >= len) return false;
-            if ((bytes[i + 1] >> 6) != 0x2) return false;
-            if ((bytes[i + 2] >> 6) != 0x2) return false;
-            if ((bytes[i + 3] >> 6) != 0x2) return false;
-            i += 4;
-        }
-        else {
-            return false;
-        }
+// LEB128 变长整数: 小于 128 的值只占 1 字节
+inline void write_varint(std::ofstream& ofs, uint64_t v) {
+    while (v >= 0x80) {
+        write_u8(ofs, static_cast<uint8_t>((v & 0x7F) | 0x80));
+        v >>= 7;
     }
-    return true;
+    write_u8(ofs, static_cast<uint8_t>(v));
 }
 
-
-
-inline std::string gbk_to_utf8(const std::string& gbk) {
-    if (gbk.empty()) return {};
-
-    // GBK -> UTF-16
-    int wlen = MultiByteToWideChar(936, 0, gbk.data(), (int)gbk.size(), nullptr, 0);
-    if (wlen <= 0) return {};
-
-    std::wstring wstr(wlen, 0);
-    MultiByteToWideChar(936, 0, gbk.data(), (int)gbk.size(), &wstr[0], wlen);
-
-    // UTF-16 -> UTF-8
-    int u8len = WideCharToMultiByte(CP_UTF8, 0, wstr.data(), wlen, nullptr, 0, nullptr, nullptr);
-    if (u8len <= 0) return {};
-
-    std::string u8(u8len, 0);
-    WideCharToMultiByte(CP_UTF8, 0, wstr.data(), wlen, &u8[0], u8len, nullptr, nullptr);
-
-    return u8;
-}
-inline std::string ensure_utf8(const std::string& s) {
-    if (s.empty()) return s;
-
-    if (is_valid_utf8(s)) {
-        return s;              // 已经是 UTF-8
+inline uint64_t read_varint(std::ifstream& ifs) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = read_u8(ifs);
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80) || !ifs) return v;
     }
-
-    return gbk_to_utf8(s);     // 不是 → 当 GBK 转
+    throw std::runtime_error("Malformed varint");
 }
 
 
-
-
-
 // -------------------- ×Ö·û´®Ð´¶Á --------------------
 inline void writeString16(std::ofstream& ofs, const std::string& str) {
     // 强制规范为 UTF-8
@@ -142,3 +89,34 @@ inline std::string readString32(std::ifstream& ifs) {
     std::string s; if (len) { s.resize(len); ifs.read(&s[0], len); }
     return s;
 }
+
+// 把文件内容刷到磁盘 (POSIX fsync / Windows FlushFileBuffers), 用于重命名前确保数据已落盘
+inline void syncFileToDisk(const std::string& path) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(std::filesystem::path(path).c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open file for sync: " + path);
+    BOOL ok = FlushFileBuffers(handle);
+    CloseHandle(handle);
+    if (!ok) throw std::runtime_error("Failed to sync file: " + path);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open file for sync: " + path);
+    int rc = ::fsync(fd);
+    ::close(fd);
+    if (rc != 0) throw std::runtime_error("Failed to sync file: " + path);
+#endif
+}
+
+// 重命名后刷新所在目录, 使新的目录项落盘 (仅 POSIX; Windows 的重命名由文件系统日志保证)
+inline void syncParentDirectory(const std::string& path) {
+#ifndef _WIN32
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
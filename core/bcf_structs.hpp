@@ -12,18 +12,18 @@ using PaletteID = uint32_t;   // paletteId
 using BlockCount = uint32_t;   // 方块数量
 using Coord = int16_t;    // 坐标 x/y/z 范围 -32767~32767
 using BlockTypeID = uint16_t;   // 方块类型 ID
-using BlockStateID = uint8_t;    // 方块状态 ID
-using StateValueID = uint8_t;    // 状态值 ID  
+using BlockStateID = uint16_t;   // 方块状态 ID (v6 起文件中为 varint)
+using StateValueID = uint32_t;   // 状态值 ID (v6 起文件中为 varint)  
 using Version = uint8_t;    // 文件版本号
 
 using StatePair = std::pair<BlockStateID, StateValueID>;
 #pragma pack(push,1)
 // -------------------- 文件头 --------------------
 
-// 扩展 BCFHeader，版本升级到 4  
+// 扩展 BCFHeader，版本升级到 8  
 struct BCFHeader {    
     char magic[3];  
-    Version version;         // 版本 4 支持 NBT 数据    
+    Version version;         // 版本 4 支持 NBT 数据, 版本 5 子区块负载压缩, 版本 6 状态 ID 改为 varint, 版本 7 palette 索引 + NBT 堆, 版本 8 校验和与文件尾    
     uint16_t width, length, height;  
     uint8_t subChunkBaseSize;  
     FilePos subChunkCount;  
@@ -32,10 +32,10 @@ struct BCFHeader {
     FilePos blockTypeMapOffset;  
     FilePos stateNameMapOffset;  
     FilePos stateValueMapOffset;  
-    FilePos nbtDataOffset;   // NBT 数据偏移量（预留）  
+    FilePos nbtDataOffset;   // NBT 堆偏移量 (v7 起; 之前 NBT 嵌入在 palette 中)  
     
     BCFHeader()  
-        : version(4), width(144), length(144), height(376),  
+        : version(8), width(144), length(144), height(376),  
         subChunkBaseSize(376), subChunkCount(0),  
         subChunkOffsetsTableOffset(0),    
         paletteOffset(0), blockTypeMapOffset(0), stateNameMapOffset(0), stateValueMapOffset(0),  
@@ -52,8 +52,10 @@ struct SubChunkHeader {
     Coord originY;
     Coord originZ;  // 新增: Z 方向起始坐标  
     BlockCount blockRegionCount;  // 改名:区域数量而非组数量  
+    uint8_t codec;                // v5: 负载压缩算法 (SubChunkCodecID)
+    uint32_t payloadSize;         // v5: 压缩后负载字节数
 
-    SubChunkHeader() : subChunkSize(0), originY(0), blockRegionCount(0) {}
+    SubChunkHeader() : subChunkSize(0), originY(0), blockRegionCount(0), codec(0), payloadSize(0) {}
 };
 
 // -------------------- 同类方块组 --------------------
@@ -125,7 +127,53 @@ struct BlockRegion {
 struct SubChunkOrigin {  
     Coord originX;  
     Coord originY;  
-    Coord originZ;  
-};  
+    Coord originZ;
+};
+
+// -------------------- 子区块目录条目 --------------------
+// 存放于文件尾部, 无需读取子区块内容即可做空间裁剪、进度估算和并行调度
+struct SubChunkDirEntry {
+    FilePos offset;                 // 子区块在文件中的偏移
+    SubChunkSize subChunkSize;      // 子区块字节数
+    Coord originX, originY, originZ;
+    BlockCount blockRegionCount;
+    Coord minX, minY, minZ;         // 区域包围盒 (相对 origin 的局部坐标)
+    Coord maxX, maxY, maxZ;
+    uint64_t blockCount;            // 区域内方块总数
+    PaletteID paletteUsedCount;     // 使用到的不同 paletteId 数量
+    PaletteID minPaletteId, maxPaletteId;
+
+    SubChunkDirEntry()
+        : offset(0), subChunkSize(0), originX(0), originY(0), originZ(0),
+        blockRegionCount(0), minX(0), minY(0), minZ(0), maxX(0), maxY(0), maxZ(0),
+        blockCount(0), paletteUsedCount(0), minPaletteId(0), maxPaletteId(0) {}
+};
+
+// -------------------- 文件尾 --------------------
+// v8 起位于文件最后; 缺失或 fileSize 不符说明文件没有写完
+struct BCFFooter {
+    char magic[4];           // "BCFE"
+    uint32_t headerCrc;      // 最终 BCFHeader 的 CRC32
+    uint32_t metadataCrc;    // [subChunkOffsetsTableOffset, 文件尾) 的 CRC32
+    FilePos fileSize;        // 含文件尾的文件总长度
+
+    BCFFooter() : headerCrc(0), metadataCrc(0), fileSize(0) {
+        magic[0] = 'B'; magic[1] = 'C'; magic[2] = 'F'; magic[3] = 'E';
+    }
+    bool hasValidMagic() const {
+        return magic[0] == 'B' && magic[1] == 'C' && magic[2] == 'F' && magic[3] == 'E';
+    }
+};
+
+// -------------------- palette 索引条目 --------------------
+// v7 palette 段: u32 paletteCount | PaletteIndexEntry[paletteCount] | 变长记录
+// 定长索引使任意 PaletteID 可 O(1) 定位, NBT 存放在独立的 NBT 堆中按需读取
+struct PaletteIndexEntry {
+    FilePos recordOffset;   // palette 记录的文件偏移
+    FilePos nbtOffset;      // NBT 在文件中的偏移 (位于 NBT 堆内)
+    uint32_t nbtSize;       // NBT 字节数, 0 表示没有 NBT
+
+    PaletteIndexEntry() : recordOffset(0), nbtOffset(0), nbtSize(0) {}
+};
 
 #pragma pack(pop)
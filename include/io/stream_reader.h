@@ -119,7 +119,59 @@ public:
      */
     std::string read_string();
 
+    /**
+     * @name Pull-style reading
+     *
+     * Instead of building the whole tag tree with read_compound, the caller
+     * can walk a compound entry by entry: read_compound_entry yields the type
+     * and key of the next entry, after which the payload must be consumed
+     * with read_payload, skip_payload or the array functions below.
+     * This allows large arrays to be processed in chunks and uninteresting
+     * entries to be skipped without allocating them.
+     * @{
+     */
+
+    /**
+     * @brief Reads the type and key of the next entry of a compound payload
+     * @return false if the end of the compound was reached
+     * @throw input_error on failure
+     */
+    bool read_compound_entry(tag_type& type, std::string& key);
+
+    /**
+     * @brief Skips a tag payload of the given type without constructing it
+     * @throw input_error on failure
+     */
+    void skip_payload(tag_type type);
+
+    /**
+     * @brief Reads the length of a Byte_Array, Int_Array or Long_Array payload
+     *
+     * The elements must then be consumed with read_array_data or skip_array_data.
+     * @throw input_error on failure or if the length is negative
+     */
+    int32_t read_array_length();
+
+    /**
+     * @brief Reads the next @p count elements of an array payload
+     * @throw input_error on failure
+     */
+    void read_array_data(int8_t* out, size_t count);
+    void read_array_data(int32_t* out, size_t count);
+    void read_array_data(int64_t* out, size_t count);
+
+    /**
+     * @brief Skips the next @p count elements of size @p elem_size of an array payload
+     * @throw input_error on failure
+     */
+    void skip_array_data(size_t count, size_t elem_size);
+
+    ///@}
+
 private:
+    void skip_bytes(uint64_t n);
+
+
     std::istream& is;
     int depth = 0;
     const endian::endian endian;
@@ -111,5 +111,156 @@ std::string stream_reader::read_string()
     return ret;
 }
 
+bool stream_reader::read_compound_entry(tag_type& type, std::string& key)
+{
+    type = read_type(true);
+    if(type == tag_type::End)
+        return false;
+    key = read_string();
+    return true;
+}
+
+void stream_reader::skip_bytes(uint64_t n)
+{
+    //istream::ignore takes a streamsize, so skip huge ranges piecewise
+    constexpr uint64_t step = 1u << 30;
+    while(n > 0)
+    {
+        uint64_t len = n < step ? n : step;
+        is.ignore(static_cast<std::streamsize>(len));
+        if(!is || static_cast<uint64_t>(is.gcount()) != len)
+        {
+            is.setstate(std::ios::failbit);
+            throw input_error("Unexpected end of stream while skipping tag");
+        }
+        n -= len;
+    }
+}
+
+void stream_reader::skip_payload(tag_type type)
+{
+    if (++depth > MAX_DEPTH)
+        throw input_error("Too deeply nested");
+    switch(type)
+    {
+    case tag_type::Byte:   skip_bytes(1); break;
+    case tag_type::Short:  skip_bytes(2); break;
+    case tag_type::Int:
+    case tag_type::Float:  skip_bytes(4); break;
+    case tag_type::Long:
+    case tag_type::Double: skip_bytes(8); break;
+
+    case tag_type::Byte_Array: skip_array_data(read_array_length(), 1); break;
+    case tag_type::Int_Array:  skip_array_data(read_array_length(), 4); break;
+    case tag_type::Long_Array: skip_array_data(read_array_length(), 8); break;
+
+    case tag_type::String:
+        {
+            uint16_t len;
+            read_num(len);
+            if(!is)
+                throw input_error("Error reading string");
+            skip_bytes(len);
+        }
+        break;
+
+    case tag_type::List:
+        {
+            tag_type lt = read_type(true);
+            int32_t length;
+            read_num(length);
+            if(length < 0)
+                is.setstate(std::ios::failbit);
+            if(!is)
+                throw input_error("Error reading length of tag_list");
+            if(lt != tag_type::End)
+                for(int32_t i = 0; i < length; ++i)
+                    skip_payload(lt);
+        }
+        break;
+
+    case tag_type::Compound:
+        {
+            tag_type tt;
+            std::string key;
+            while(read_compound_entry(tt, key))
+                skip_payload(tt);
+        }
+        break;
+
+    default:
+        is.setstate(std::ios::failbit);
+        throw input_error("Cannot skip tag of invalid type");
+    }
+    --depth;
+}
+
+int32_t stream_reader::read_array_length()
+{
+    int32_t length;
+    read_num(length);
+    if(length < 0)
+        is.setstate(std::ios::failbit);
+    if(!is)
+        throw input_error("Error reading length of array tag");
+    return length;
+}
+
+void stream_reader::read_array_data(int8_t* out, size_t count)
+{
+    is.read(reinterpret_cast<char*>(out), count);
+    if(!is)
+        throw input_error("Error reading contents of tag_byte_array");
+}
+
+namespace //anonymous
+{
+    //Reads count elements of N bytes in one go and assembles them in the given byte order
+    template<class U, size_t N>
+    void read_packed(std::istream& is, U* out, size_t count, endian::endian e)
+    {
+        constexpr size_t chunk = 4096;
+        uint8_t buf[chunk * N];
+        while(count > 0)
+        {
+            size_t n = count < chunk ? count : chunk;
+            is.read(reinterpret_cast<char*>(buf), n * N);
+            if(!is)
+                return;
+            for(size_t i = 0; i < n; ++i)
+            {
+                const uint8_t* p = buf + i * N;
+                U v = 0;
+                if(e == endian::big)
+                    for(size_t b = 0; b < N; ++b) v = (v << 8) | p[b];
+                else
+                    for(size_t b = N; b-- > 0; ) v = (v << 8) | p[b];
+                out[i] = v;
+            }
+            out += n;
+            count -= n;
+        }
+    }
+}
+
+void stream_reader::read_array_data(int32_t* out, size_t count)
+{
+    read_packed<uint32_t, 4>(is, reinterpret_cast<uint32_t*>(out), count, endian);
+    if(!is)
+        throw input_error("Error reading contents of tag_int_array");
+}
+
+void stream_reader::read_array_data(int64_t* out, size_t count)
+{
+    read_packed<uint64_t, 8>(is, reinterpret_cast<uint64_t*>(out), count, endian);
+    if(!is)
+        throw input_error("Error reading contents of tag_long_array");
+}
+
+void stream_reader::skip_array_data(size_t count, size_t elem_size)
+{
+    skip_bytes(static_cast<uint64_t>(count) * elem_size);
+}
+
 }
 }